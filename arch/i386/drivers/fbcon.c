@@ -0,0 +1,430 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     arch/i386/drivers/fbcon.c
+ * Description:   The framebuffer display of the console
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* A display for the console on a linear framebuffer of 32 bit
+ * pixels, either the one the boot loader set up and told us about in
+ * the multiboot information, or one we set up ourselves on the VGA of
+ * Bochs and QEMU through its VBE extensions (the DISPI interface).
+ *
+ * The framebuffer is mapped write combining, and every character is
+ * drawn a scan line at a time across a whole run of cells, with one
+ * 32 bit store per pixel, so the stores go out in bursts.
+ *
+ * The font is the 8x16 one the VGA BIOS loaded into plane 2 of the
+ * video memory for text mode, read out before we change the mode on
+ * the Bochs VGA. A boot loader that set up a framebuffer has already
+ * left text mode and the font in plane 2 with it, so then the font is
+ * looked up in the VGA BIOS instead. It is pre-expanded: font_mask
+ * has the eight pixel masks for every possible byte of a glyph, so a
+ * scan line of a character is eight stores of bg ^ ( (fg ^ bg) & mask)
+ * with no bit tests.
+ *
+ * On the Bochs VGA the framebuffer is taller than the screen and
+ * scrolling moves the Y offset of the display down, just like the
+ * start address of the CRTC in text mode. A framebuffer we can not
+ * pan has no room below the screen, so the console redraws the lines
+ * in view when it scrolls. It never moves pixels around within the
+ * framebuffer, as reading it back is slower than drawing it again.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/log.h>
+#include <nodes/devices.h>
+#include <asm/mm.h>
+#include <asm/io.h>
+#include <multiboot.h>
+#include <io.h>
+
+
+#ifdef CONFIG_FBCON
+
+#define FONT_WIDTH   8
+#define FONT_HEIGHT  16
+
+#define FB_WIDTH     1024   /* The mode we set up ourselves */
+#define FB_HEIGHT    768
+#define FB_MAP_MAX   0x800000   /* Most of the framebuffer we map */
+
+/* The VGA registers that get at the font in plane 2 */
+#define VGA_PLANES   0xa0000
+#define VGA_SEQ      0x3c4
+#define VGA_GC       0x3ce
+#define SEQ_MAP_MASK   0x02
+#define SEQ_MEM_MODE   0x04
+#define GC_READ_MAP    0x04
+#define GC_MODE        0x05
+#define GC_MISC        0x06
+
+/* Where the VGA BIOS is */
+#define VGA_ROM       0xc0000
+#define VGA_ROM_SIZE  0x8000
+
+/* The Bochs VBE registers */
+#define DISPI_INDEX    0x1ce
+#define DISPI_DATA     0x1cf
+#define DISPI_ID         0x0
+#define DISPI_XRES       0x1
+#define DISPI_YRES       0x2
+#define DISPI_BPP        0x3
+#define DISPI_ENABLE     0x4
+#define DISPI_VIRT_WIDTH   0x6
+#define DISPI_Y_OFFSET     0x9
+#define DISPI_VIDEO_MEMORY_64K  0xa
+#define DISPI_ID0        0xb0c0
+#define DISPI_ID5        0xb0c5
+#define DISPI_ENABLED      0x01
+#define DISPI_LFB_ENABLED  0x40
+
+#define PCI_CONFIG_ADDR  0xcf8
+#define PCI_CONFIG_DATA  0xcfc
+#define PCI_BAR0         0x10
+#define BOCHS_VGA_ID     0x11111234   /* Device and vendor */
+#define BOCHS_LFB        0xe0000000   /* Where it is without PCI */
+
+
+static struct {
+	volatile u8_t *base;
+	u32_t pitch;        /* Bytes from a scan line to the next */
+	u32_t width;
+	u32_t height;
+	u32_t lines;        /* Lines of text the mapping holds */
+	u32_t bochs;        /* Set if we can pan with DISPI_Y_OFFSET */
+
+	u32_t palette[16];  /* The colours of text mode as pixels */
+} fb;
+
+static u8_t font[256][FONT_HEIGHT];
+static u32_t font_mask[256][FONT_WIDTH];
+
+/* The 16 colours of text mode, as 0xRRGGBB */
+static const u32_t vga_colours[16] = {
+	0x000000, 0x0000aa, 0x00aa00, 0x00aaaa,
+	0xaa0000, 0xaa00aa, 0xaa5500, 0xaaaaaa,
+	0x555555, 0x5555ff, 0x55ff55, 0x55ffff,
+	0xff5555, 0xff55ff, 0xffff55, 0xffffff
+};
+
+
+static void fb_draw (u32_t line, u32_t col, const u16_t *cells, u32_t n)
+{
+	volatile u8_t *row = fb.base + line * FONT_HEIGHT * fb.pitch +
+		col * FONT_WIDTH * 4;
+	volatile u32_t *dst;
+	u32_t y, i, fg, bg, x;
+	const u32_t *m;
+	u16_t cell;
+
+	for (y = 0; y < FONT_HEIGHT; y++, row += fb.pitch){
+		dst = (volatile u32_t *) row;
+
+		for (i = 0; i < n; i++, dst += FONT_WIDTH){
+			cell = cells[i];
+			fg = fb.palette[ (cell >> 8) & 0xf];
+			bg = fb.palette[ (cell >> 12) & 0x7];
+			x = fg ^ bg;
+			m = font_mask[font[cell & 0xff][y]];
+
+			dst[0] = bg ^ (x & m[0]);
+			dst[1] = bg ^ (x & m[1]);
+			dst[2] = bg ^ (x & m[2]);
+			dst[3] = bg ^ (x & m[3]);
+			dst[4] = bg ^ (x & m[4]);
+			dst[5] = bg ^ (x & m[5]);
+			dst[6] = bg ^ (x & m[6]);
+			dst[7] = bg ^ (x & m[7]);
+		}
+	}
+}
+
+
+static void dispi_write (u16_t reg, u16_t val)
+{
+	outw (reg, DISPI_INDEX);
+	outw (val, DISPI_DATA);
+}
+
+static u16_t dispi_read (u16_t reg)
+{
+	outw (reg, DISPI_INDEX);
+	return inw (DISPI_DATA);
+}
+
+
+static void fb_set_origin (u32_t line)
+{
+	if (fb.bochs) dispi_write (DISPI_Y_OFFSET, line * FONT_HEIGHT);
+}
+
+
+/* The cursor is the cell under it with the colours swapped */
+
+static void fb_cursor (u32_t line, u32_t col, u16_t cell)
+{
+	cell = (cell & 0xff) | ( (cell & 0x0f00) << 4) | ( (cell & 0x7000) >> 4);
+
+	fb_draw (line, col, &cell, 1);
+}
+
+static struct display fb_display = {
+	"fb", 0, 0, 0, 1, fb_draw, fb_set_origin, fb_cursor
+};
+
+
+/* Copy the font out of plane 2, which only holds it while the VGA is
+ * in text mode. Each glyph takes 32 bytes there, of which the first
+ * 16 are used. */
+
+static void read_vga_font (void)
+{
+	volatile u8_t *planes = (volatile u8_t *) VGA_PLANES;
+	u32_t c, y;
+
+	/* Read plane 2 on its own, linearly, from 0xa0000 */
+	outb (SEQ_MAP_MASK, VGA_SEQ);   outb (0x04, VGA_SEQ + 1);
+	outb (SEQ_MEM_MODE, VGA_SEQ);   outb (0x07, VGA_SEQ + 1);
+	outb (GC_READ_MAP, VGA_GC);     outb (0x02, VGA_GC + 1);
+	outb (GC_MODE, VGA_GC);         outb (0x00, VGA_GC + 1);
+	outb (GC_MISC, VGA_GC);         outb (0x04, VGA_GC + 1);
+
+	for (c = 0; c < 256; c++)
+		for (y = 0; y < FONT_HEIGHT; y++)
+			font[c][y] = planes[c * 32 + y];
+
+	/* Back to odd/even text mode at 0xb8000 */
+	outb (SEQ_MAP_MASK, VGA_SEQ);   outb (0x03, VGA_SEQ + 1);
+	outb (SEQ_MEM_MODE, VGA_SEQ);   outb (0x03, VGA_SEQ + 1);
+	outb (GC_READ_MAP, VGA_GC);     outb (0x00, VGA_GC + 1);
+	outb (GC_MODE, VGA_GC);         outb (0x10, VGA_GC + 1);
+	outb (GC_MISC, VGA_GC);         outb (0x0e, VGA_GC + 1);
+}
+
+
+/* The 'A' of the 8x16 font of the IBM VGA, which the VGA BIOS of
+ * Bochs and QEMU and most others carry */
+static const u8_t rom_glyph_a[FONT_HEIGHT] = {
+	0x00, 0x00, 0x10, 0x38, 0x6c, 0xc6, 0xc6, 0xfe,
+	0xc6, 0xc6, 0xc6, 0xc6, 0x00, 0x00, 0x00, 0x00
+};
+
+/* Find the font in the VGA BIOS by its 'A' and copy it. Returns 0 if
+ * there is none we know. */
+
+static int read_rom_font (void)
+{
+	const u8_t *rom = (const u8_t *) VGA_ROM, *glyphs;
+	u32_t off, c, y;
+
+	for (off = 'A' * FONT_HEIGHT;
+	     off <= VGA_ROM_SIZE - (256 - 'A') * FONT_HEIGHT; off++){
+
+		for (y = 0; y < FONT_HEIGHT; y++)
+			if (rom[off + y] != rom_glyph_a[y]) break;
+		if (y < FONT_HEIGHT) continue;
+
+		glyphs = rom + off - 'A' * FONT_HEIGHT;
+		for (c = 0; c < 256; c++)
+			for (y = 0; y < FONT_HEIGHT; y++)
+				font[c][y] = glyphs[c * FONT_HEIGHT + y];
+		return 1;
+	}
+
+	return 0;
+}
+
+
+static void expand_font (void)
+{
+	u32_t b, c;
+
+	for (b = 0; b < 256; b++)
+		for (c = 0; c < FONT_WIDTH; c++)
+			font_mask[b][c] = (b & (0x80 >> c)) ? 0xffffffff : 0;
+}
+
+
+/* Turn 0xRRGGBB into a pixel with the given field positions and
+ * sizes */
+
+static u32_t make_pixel (u32_t rgb, u32_t rpos, u32_t rsize, u32_t gpos,
+			 u32_t gsize, u32_t bpos, u32_t bsize)
+{
+	u32_t r = (rgb >> 16) & 0xff, g = (rgb >> 8) & 0xff, b = rgb & 0xff;
+
+	return ( (r >> (8 - rsize)) << rpos) | ( (g >> (8 - gsize)) << gpos) |
+		( (b >> (8 - bsize)) << bpos);
+}
+
+
+/* Whether the boot loader has set up a graphics mode */
+
+static int multiboot_graphics (void)
+{
+	multiboot_info_t *mbi = _mbi;
+
+	return mbi && is_bit_set (mbi->flags, MULTIBOOT_INFO_FRAMEBUFFER) &&
+		mbi->framebuffer_type != MULTIBOOT_FRAMEBUFFER_TEXT;
+}
+
+
+/* Take the framebuffer the boot loader set up, if it is one we can
+ * draw on */
+
+static u32_t probe_multiboot (void)
+{
+	multiboot_info_t *mbi = _mbi;
+	u32_t i;
+
+	if (mbi->framebuffer_type != MULTIBOOT_FRAMEBUFFER_RGB ||
+	    mbi->framebuffer_bpp != 32 || (mbi->framebuffer_addr >> 32))
+		return 0;
+
+	if (!read_rom_font()) return 0;
+
+	fb.pitch = mbi->framebuffer_pitch;
+	fb.width = mbi->framebuffer_width;
+	fb.height = mbi->framebuffer_height;
+	fb.bochs = 0;
+
+	for (i = 0; i < 16; i++)
+		fb.palette[i] = make_pixel (vga_colours[i],
+					    mbi->red_field_position,
+					    mbi->red_mask_size,
+					    mbi->green_field_position,
+					    mbi->green_mask_size,
+					    mbi->blue_field_position,
+					    mbi->blue_mask_size);
+
+	return (u32_t) mbi->framebuffer_addr;
+}
+
+
+/* Look for the Bochs VGA on the first PCI bus and return where its
+ * framebuffer is */
+
+static u32_t bochs_lfb (void)
+{
+	u32_t dev;
+
+	for (dev = 0; dev < 32; dev++){
+		outl (0x80000000 | (dev << 11), PCI_CONFIG_ADDR);
+		if (inl (PCI_CONFIG_DATA) != BOCHS_VGA_ID) continue;
+
+		outl (0x80000000 | (dev << 11) | PCI_BAR0, PCI_CONFIG_ADDR);
+		return inl (PCI_CONFIG_DATA) & ~0xf;
+	}
+
+	return BOCHS_LFB;
+}
+
+
+/* Find the Bochs VGA and work out the mode we will set up on it.
+ * Returns the physical address of the framebuffer, or 0 if this is
+ * not one. The mode is only switched by bochs_set_mode, once the
+ * framebuffer is mapped. */
+
+static u32_t probe_bochs (void)
+{
+	u16_t id = dispi_read (DISPI_ID);
+	u32_t i;
+
+	if (id < DISPI_ID0 || id > DISPI_ID5) return 0;
+
+	fb.pitch = FB_WIDTH * 4;
+	fb.width = FB_WIDTH;
+	fb.bochs = 1;
+
+	/* All of the video memory is room to pan */
+	fb.height = dispi_read (DISPI_VIDEO_MEMORY_64K) * 0x10000 / fb.pitch;
+
+	if (fb.height < FB_HEIGHT) fb.height = FB_HEIGHT;
+
+	for (i = 0; i < 16; i++) fb.palette[i] = vga_colours[i];
+
+	return bochs_lfb();
+}
+
+
+static void bochs_set_mode (void)
+{
+	/* The mode switch overwrites the font */
+	read_vga_font();
+
+	dispi_write (DISPI_ENABLE, 0);
+	dispi_write (DISPI_XRES, FB_WIDTH);
+	dispi_write (DISPI_YRES, FB_HEIGHT);
+	dispi_write (DISPI_BPP, 32);
+	dispi_write (DISPI_VIRT_WIDTH, FB_WIDTH);
+	dispi_write (DISPI_ENABLE, DISPI_ENABLED | DISPI_LFB_ENABLED);
+	dispi_write (DISPI_Y_OFFSET, 0);
+}
+
+
+void init_fbcon (void)
+{
+	u32_t phys, size;
+
+	/* Plane 2 is no use once the loader has left text mode */
+	if (multiboot_graphics()) phys = probe_multiboot();
+	else phys = probe_bochs();
+	if (!phys) return;
+
+	size = fb.height * fb.pitch;
+	if (size > FB_MAP_MAX) size = FB_MAP_MAX;
+
+	fb.base = ioremap (phys, size, PAGE_WRITE_COMBINE);
+	if (!fb.base) return;
+
+	/* Text mode is only given up once there is somewhere else to
+	 * draw, or a failed mapping would leave nothing on the screen */
+	if (fb.bochs) bochs_set_mode();
+
+	expand_font();
+
+	fb.lines = size / fb.pitch / FONT_HEIGHT;
+
+	fb_display.cols = fb.width / FONT_WIDTH;
+	fb_display.rows = (fb.bochs ? FB_HEIGHT : fb.height) / FONT_HEIGHT;
+	if (fb_display.rows > fb.lines) fb_display.rows = fb.lines;
+	fb_display.lines = fb.bochs ? fb.lines : fb_display.rows;
+
+	console_set_display (&fb_display);
+
+	printk (LOG_INFO, "Console on a %ux%u framebuffer at 0x%x, %u x %u\n",
+		fb.width, fb_display.rows * FONT_HEIGHT, phys,
+		fb_display.cols, fb_display.rows);
+}
+
+#endif /* CONFIG_FBCON */
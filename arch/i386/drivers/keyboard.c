@@ -14,6 +14,13 @@
 #include <io.h>
 #include <asm/io.h>
 #include <asm/interrupt.h>
+#include <nodes/ring.h>
+#include <nodes/tty.h>
+#include <nodes/trace.h>
+#include <nodes/profile.h>
+#include <nodes/callgraph.h>
+#include <nodes/boot_phase.h>
+#include <asm/msr.h>
 
 /* Standard and AT keyboard.  (PS/2 MCA implies AT throughout.) */
 #define KEYBD		0x60	/* I/O port for keyboard data */
@@ -39,7 +46,10 @@
 
 #define KB_IRQ             1     /* Our Keyboard IRQ number is 1 */
 
-#define KB_IN_BYTES	  32	/* size of keyboard input buffer */
+#define KB_SCROLL_LINES	  12	/* lines Ctrl-PgUp/PgDn scroll the console */
+
+#define KB_IN_CODES	  256	/* size of keyboard input buffer, a
+				 * power of two */
 
 static int alt1;		/* left alt key state */
 static int alt2;		/* right alt key state */
@@ -56,25 +66,30 @@ static int shift;		/* shift key state */
 static char numpad_map[] =
 {'H', 'Y', 'A', 'B', 'D', 'C', 'V', 'U', 'G', 'S', 'T', '@'};
 
-/* Keyboard structure, 1 per console. */
-struct kb_s {
-	char *ihead;			/* next free spot in input buffer */
-	char *itail;			/* scan code to return to TTY */
-	int icount;			/* # codes in buffer */
-	char ibuf[KB_IN_BYTES];	/* input buffer */
+/* A scan code and the time stamp counter when it came in */
+struct kb_scan {
+	u64_t stamp;
+	u8_t code;
 };
 
-static struct kb_s keyb;
+/* Scan codes on their way from the interrupt handler, which is the
+ * only producer, to kb_read in the keyboard thread, which is the only
+ * consumer. */
+DEFINE_RING (kb_ring, struct kb_scan, KB_IN_CODES);
 
 static int kb_ack (void);
 static int kb_wait (void);
 static int scan_keyboard (void);
 static u32_t make_break (int scode);
 static void set_leds (void);
-void kbd_hw_int (void);
-static void kb_read (void);
+static int kbd_hw_int (u32_t irq, void *dev);
+static int kb_read (u32_t irq, void *dev);
 static unsigned map_key (int scode);
 
+static struct irq_action kb_action = {	/* our entry on the irq line */
+	kbd_hw_int, kb_read, &kb_ring, "keyboard"
+};
+
 
 /*===========================================================================*
  *				map_key0				     *
@@ -118,16 +133,19 @@ static unsigned map_key(int scode)
 /*===========================================================================*
  *				kbd_hw_int				     *
  *===========================================================================*/
-void kbd_hw_int(void)
+static int kbd_hw_int(u32_t irq, void *dev)
 {
 /* A keyboard interrupt has occurred.  Process it. */
 
 	int code;
 	unsigned km;
+	struct kb_scan scan;
 	
 	/* Fetch the character from the keyboard hardware and acknowledge it. */
 	code = scan_keyboard();
 
+	trace (TRACE_KB_SCAN, code, 0, 0);
+
 	/* The IBM keyboard interrupts twice per key, once when depressed, once when
 	 * released.  Filter out the latter, ignoring all but the shift-type keys.
 	 * The shift-type keys 29, 42, 54, 56, 58, and 69 must be processed normally.
@@ -138,57 +156,64 @@ void kbd_hw_int(void)
 		km = map_key0(code & 0177);
 		if (km != CTRL && km != SHIFT && km != ALT && km != CALOCK
 		    && km != NLOCK && km != SLOCK && km != EXTKEY)
-			return ;
+			return IRQ_HANDLED;
 	}
 
-	/* Store the character in memory so the task can get at it later. */
-	if (keyb.icount < KB_IN_BYTES) {
-		*keyb.ihead++ = code;
-		if (keyb.ihead == keyb.ibuf + KB_IN_BYTES) keyb.ihead = keyb.ibuf;
-		keyb.icount++;
+	/* Store the character in memory so the task can get at it
+	 * later. If it doesn't fit it is discarded, the ring counts
+	 * it. */
+	scan.stamp = rdtsc();
+	scan.code = code;
+	ring_put (&kb_ring, &scan);
 
-	} 
-
-	kb_read();
-	/* Else it doesn't fit - discard it. */
-/*  return 1;	 Reenable keyboard interrupt */
+	return IRQ_WAKE_THREAD;
 }
 
 
 /* NOTE (6/1/2004) "Apurva Mehta" <apurva@gmx.net> : The following
- * function has been modified from the minix original because I still
- * do not have a multi tasking infrastructure. Whenever you encounter
- * a `putchar', it means that the character is in ASCII and is ready
- * to be sent to whoever has asked for it.
+ * function has been modified from the minix original. Whenever you
+ * encounter a `tty_receive', it means that the character is in ASCII
+ * and is ready to be sent to whoever has asked for it.
+ *
+ * It is the threaded half of the keyboard interrupt, so it runs with
+ * interrupts enabled. IRQ1 stays masked until it returns (see
+ * irq_wake_thread), so kbd_hw_int does not run in the meantime, and
+ * set_leds and kb_ack count on that to talk to the controller.
  */
 
 /*==========================================================================*
  *				kb_read					    *
  *==========================================================================*/
-static void kb_read()
+static int kb_read(u32_t irq, void *dev)
 {
 /* Process characters from the circular keyboard buffer. */
 
-	int scode;
+	struct kb_scan scan;
 	u32_t ch;
 
   
-	while (keyb.icount > 0) {
-		scode = *keyb.itail++;			/* take one key scan code */
-		if (keyb.itail == keyb.ibuf + KB_IN_BYTES) keyb.itail = keyb.ibuf;
-		keyb.icount--;
+	while (ring_get (&kb_ring, &scan)) {	/* take one key scan code */
 	
 
 		/* Perform make/break processing. */
-		ch = make_break(scode);
+		ch = make_break(scan.code);
 
 		if (ch <= 0xFF) {
-			/* A normal character. */
-			putchar (ch);
+			/* A normal character, for the console on
+			 * the display */
+			tty_receive (console_foreground(), ch, scan.stamp);
 
 		}
+		else if (ch == CPGUP) console_scroll (KB_SCROLL_LINES);
+		else if (ch == CPGDN) console_scroll (-KB_SCROLL_LINES);
+		else if (ch == CF10) callgraph_print();
+		else if (ch == CF11) profile_print();
+		else if (ch == CF12) trace_request_dump();
+
 		/* Not checking for ANSI escape sequences for now */
 	}
+
+	return IRQ_HANDLED;
 }
 
 /*===========================================================================*
@@ -270,6 +295,12 @@ static u32_t make_break(int scode)
 		return(-1);
   	default:
 		if (!make) ch = -1;
+
+		/* Alt+F1 and on bring up the virtual consoles */
+		else if (ch >= AF1 && ch < AF1 + NR_CONSOLES){
+			console_switch (ch - AF1);
+			ch = -1;
+		}
 	}
 	esc = 0;
 	return(ch);
@@ -335,21 +366,23 @@ void kb_init()
 {
 /* Initialize the keyboard driver. */
 
-	/* Set up input queue. */
-	keyb.ihead = keyb.itail = keyb.ibuf;
-
 	/* Set initial values. */
 	caps_off = 1;
 	num_off = 1;
 	slock_off = 1;
 	esc = 0;
 
+	boot_phase ("set_leds");
+
 	set_leds();			/* turn off numlock led */
 
+	boot_phase ("kb_request_irq");
+
 	scan_keyboard();		/* stop lockup from leftover keystroke */
 
- 	set_irq_handler( KB_IRQ, kbd_hw_int);	/*  set the interrupt handler */
- 	enable_irq( KB_IRQ );	/* safe now everything initialised! */
+ 	request_irq( KB_IRQ, &kb_action);	/* set the handler and enable the
+						 * irq, safe now everything
+						 * initialised! */
 }
 
 
@@ -0,0 +1,379 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     arch/i386/drivers/serial.c
+ * Description:   Driver for the 16550 UART
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* The first serial port, run at 115200 baud, 8N1, with the 16 byte
+ * FIFOs of the 16550A on.
+ *
+ * Output goes through a ring. A writer puts bytes in it and turns on
+ * the transmitter empty interrupt, and the interrupt handler refills
+ * the FIFO from the ring, SERIAL_FIFO bytes per interrupt, and turns
+ * the interrupt off again once the ring is empty. A writer that finds
+ * the ring full sleeps until the handler has made room, so a long
+ * burst of output goes out at the line rate without anyone spinning
+ * on the line status register.
+ *
+ * Until serial_init_irq, and with interrupts disabled, as they are
+ * when the system is dying, bytes are written straight to the FIFO
+ * instead, waiting for it to drain every SERIAL_FIFO bytes.
+ *
+ * Input is taken by the interrupt handler into a ring, like the
+ * keyboard does, and handed to the tty by the threaded half.
+ */
+
+#include <sys/types.h>
+#include <nodes/ring.h>
+#include <nodes/wait.h>
+#include <nodes/mutex.h>
+#include <nodes/spinlock.h>
+#include <nodes/log.h>
+#include <nodes/tty.h>
+#include <nodes/devices.h>
+#include <asm/interrupt.h>
+#include <asm/atomic.h>
+#include <asm/msr.h>
+#include <asm/io.h>
+
+
+#define COM1         0x3f8
+#define COM1_IRQ     4
+
+#define UART_CLOCK   115200   /* The divisor latch divides this */
+#define SERIAL_BAUD  115200
+
+/* The registers, as offsets from the base port */
+#define UART_RBR     0   /* Receive buffer (read) */
+#define UART_THR     0   /* Transmit holding (write) */
+#define UART_DLL     0   /* Divisor latch, low byte (DLAB set) */
+#define UART_IER     1   /* Interrupt enable */
+#define UART_DLM     1   /* Divisor latch, high byte (DLAB set) */
+#define UART_IIR     2   /* Interrupt identification (read) */
+#define UART_FCR     2   /* FIFO control (write) */
+#define UART_LCR     3   /* Line control */
+#define UART_MCR     4   /* Modem control */
+#define UART_LSR     5   /* Line status */
+#define UART_MSR     6   /* Modem status */
+#define UART_SCR     7   /* Scratch */
+
+#define IER_RDI      0x01   /* Received data available */
+#define IER_THRI     0x02   /* Transmit holding register empty */
+#define IER_RLSI     0x04   /* Receiver line status */
+
+#define IIR_NO_INT   0x01   /* No interrupt pending */
+#define IIR_ID       0x0e   /* Which one it is */
+#define IIR_MSI      0x00
+#define IIR_THRI     0x02
+#define IIR_RDI      0x04
+#define IIR_RLSI     0x06
+#define IIR_RX_TIMEOUT  0x0c   /* Data in the FIFO below the trigger */
+#define IIR_FIFO     0xc0   /* Both set on a 16550A with FIFOs on */
+
+#define FCR_ENABLE   0x01
+#define FCR_CLEAR_RX 0x02
+#define FCR_CLEAR_TX 0x04
+#define FCR_TRIG_14  0xc0   /* Interrupt at 14 received bytes */
+
+#define LCR_8N1      0x03
+#define LCR_DLAB     0x80   /* Divisor latch access */
+
+#define MCR_DTR      0x01
+#define MCR_RTS      0x02
+#define MCR_OUT2     0x08   /* Lets the UART interrupt through */
+
+#define LSR_DR       0x01   /* Data ready */
+#define LSR_THRE     0x20   /* Transmit holding register empty */
+
+#define SERIAL_FIFO     16     /* Bytes the transmit FIFO holds */
+#define SERIAL_TX_SIZE  4096   /* Bytes queued for output, a power of
+				* two */
+#define SERIAL_RX_SIZE  256    /* Bytes received and not yet handed
+				* to the tty, a power of two */
+
+/* A received byte and the time stamp counter when it came in */
+struct serial_rx {
+	u64_t stamp;
+	u8_t ch;
+};
+
+/* Written to by writers holding serial_tx_mutex, emptied by the
+ * interrupt handler */
+DEFINE_RING (serial_tx, u8_t, SERIAL_TX_SIZE);
+
+/* Filled by the interrupt handler, emptied by the serial thread */
+DEFINE_RING (serial_rx, struct serial_rx, SERIAL_RX_SIZE);
+
+static DEFINE_MUTEX (serial_tx_mutex);
+static DECLARE_WAIT_QUEUE_HEAD (serial_tx_wait);
+
+static DEFINE_SPINLOCK (serial_ier_lock);
+static u8_t serial_ier;           /* What is in UART_IER */
+
+static u32_t serial_fifo;         /* Bytes to put in the FIFO at once */
+static volatile u32_t serial_irq_on;
+
+static int serial_interrupt (u32_t irq, void *dev);
+static int serial_read (u32_t irq, void *dev);
+
+static struct irq_action serial_action = {
+	serial_interrupt, serial_read, &serial_rx, "serial"
+};
+
+
+static struct log_sink serial_sink = {
+	"serial", serial_write, LOG_DEBUG
+};
+
+
+static inline u8_t serial_in (u32_t reg)
+{
+	return inb (COM1 + reg);
+}
+
+static inline void serial_out (u32_t reg, u8_t val)
+{
+	outb (val, COM1 + reg);
+}
+
+
+static void set_ier (u8_t set, u8_t clear)
+{
+	u32_t flags;
+
+	spin_lock_irqsave (&serial_ier_lock, flags);
+	serial_ier = (serial_ier & ~clear) | set;
+	serial_out (UART_IER, serial_ier);
+	spin_unlock_irqrestore (&serial_ier_lock, flags);
+}
+
+
+/* Write a byte the slow way. `room' is what is left of the FIFO,
+ * which is only known to be empty once the transmitter says so. */
+
+static void serial_poll_putc (char c, u32_t *room)
+{
+	if (!*room){
+		while (!(serial_in (UART_LSR) & LSR_THRE)) cpu_relax();
+		*room = serial_fifo;
+	}
+
+	serial_out (UART_THR, c);
+	(*room)--;
+}
+
+static void serial_poll_write (const char *s, u32_t n)
+{
+	u32_t room = 0;
+
+	for (; n; s++, n--){
+		if (*s == '\n') serial_poll_putc ('\r', &room);
+		serial_poll_putc (*s, &room);
+	}
+}
+
+
+/* Queue a byte, sleeping while the ring is full. The transmitter is
+ * turned on first so the ring is sure to drain. */
+
+static void serial_queue (char c)
+{
+	if (ring_count (&serial_tx) == SERIAL_TX_SIZE){
+		set_ier (IER_THRI, 0);
+		wait_event (serial_tx_wait,
+			    ring_count (&serial_tx) < SERIAL_TX_SIZE);
+	}
+
+	ring_put (&serial_tx, &c);
+}
+
+
+/* Write `n' bytes, turning every '\n' into "\r\n" for the terminal
+ * on the other end */
+
+void serial_write (const char *s, u32_t n)
+{
+	u32_t flags;
+
+	local_save_flags (flags);
+
+	if (!serial_irq_on || irqs_disabled_flags (flags)){
+		serial_poll_write (s, n);
+		return;
+	}
+
+	mutex_lock (&serial_tx_mutex);
+
+	for (; n; s++, n--){
+		if (*s == '\n') serial_queue ('\r');
+		serial_queue (*s);
+	}
+
+	set_ier (IER_THRI, 0);
+
+	mutex_unlock (&serial_tx_mutex);
+}
+
+
+/* Refill the transmit FIFO from the ring, or turn the transmitter
+ * interrupt off if there is nothing left to send */
+
+static void serial_tx_fill (void)
+{
+	u32_t i;
+	u8_t c;
+
+	for (i = 0; i < serial_fifo && ring_get (&serial_tx, &c); i++)
+		serial_out (UART_THR, c);
+
+	/* Checked again under the lock, as a writer may have queued
+	 * something and turned the interrupt on in the meantime */
+	raw_spin_lock (&serial_ier_lock);
+	if (ring_empty (&serial_tx)){
+		serial_ier &= ~IER_THRI;
+		serial_out (UART_IER, serial_ier);
+	}
+	raw_spin_unlock (&serial_ier_lock);
+
+	/* The room we made must be seen before we look for writers
+	 * waiting for it; prepare_to_wait has the other barrier. The
+	 * lock above is no barrier on a uniprocessor build. */
+	mb();
+
+	if (i && waitqueue_active (&serial_tx_wait)) wake_up (&serial_tx_wait);
+}
+
+
+static int serial_interrupt (u32_t irq, void *dev)
+{
+	struct serial_rx rx;
+	int ret = IRQ_NONE;
+	u8_t iir;
+
+	while (!( (iir = serial_in (UART_IIR)) & IIR_NO_INT)){
+		if (ret == IRQ_NONE) ret = IRQ_HANDLED;
+
+		switch (iir & IIR_ID){
+		case IIR_RDI:
+		case IIR_RX_TIMEOUT:
+			/* If it does not fit it is dropped, the ring
+			 * counts it */
+			while (serial_in (UART_LSR) & LSR_DR){
+				rx.stamp = rdtsc();
+				rx.ch = serial_in (UART_RBR);
+				ring_put (&serial_rx, &rx);
+			}
+			ret = IRQ_WAKE_THREAD;
+			break;
+
+		case IIR_THRI:
+			serial_tx_fill();
+			break;
+
+		case IIR_RLSI:
+			serial_in (UART_LSR);
+			break;
+
+		case IIR_MSI:
+			serial_in (UART_MSR);
+			break;
+		}
+	}
+
+	return ret;
+}
+
+
+/* The threaded half. Hands what came in to the tty. */
+
+static int serial_read (u32_t irq, void *dev)
+{
+	struct serial_rx rx;
+
+	while (ring_get (&serial_rx, &rx))
+		tty_receive (0, rx.ch, rx.stamp);
+
+	return IRQ_HANDLED;
+}
+
+
+/* Set the port up for polled output and make it a sink of the kernel
+ * log. Does nothing if there is no UART. */
+
+void serial_init (void)
+{
+	u32_t divisor = UART_CLOCK / SERIAL_BAUD;
+
+	/* Nothing answers on the port if there is no UART */
+	serial_out (UART_SCR, 0x5a);
+	if (serial_in (UART_SCR) != 0x5a) return;
+
+	serial_out (UART_IER, 0);
+
+	serial_out (UART_LCR, LCR_DLAB);
+	serial_out (UART_DLL, divisor & 0xff);
+	serial_out (UART_DLM, divisor >> 8);
+	serial_out (UART_LCR, LCR_8N1);
+
+	serial_out (UART_FCR, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX |
+		    FCR_TRIG_14);
+
+	/* An 8250 or 16450 has no FIFO, and a 16550 a broken one */
+	if ( (serial_in (UART_IIR) & IIR_FIFO) == IIR_FIFO)
+		serial_fifo = SERIAL_FIFO;
+	else{
+		serial_out (UART_FCR, 0);
+		serial_fifo = 1;
+	}
+
+	serial_out (UART_MCR, MCR_DTR | MCR_RTS | MCR_OUT2);
+
+	/* Throw away whatever was there */
+	while (serial_in (UART_LSR) & LSR_DR) serial_in (UART_RBR);
+
+	register_log_sink (&serial_sink);
+}
+
+
+/* Switch to interrupt driven output and start taking input. Needs
+ * the scheduler, for the thread that takes the input. */
+
+void serial_init_irq (void)
+{
+	if (!serial_fifo) return;
+
+	if (request_irq (COM1_IRQ, &serial_action)) return;
+
+	set_ier (IER_RDI | IER_RLSI, 0);
+
+	store_release (&serial_irq_on, 1);
+}
@@ -0,0 +1,574 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     arch/i386/drivers/vga.c
+ * Description:   The virtual consoles, and the VGA text display
+ *                under them.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* There are NR_CONSOLES virtual consoles, of which one, the
+ * foreground, is on the display. Everything printed on a console
+ * goes into its shadow in memory first. The shadow is a ring of
+ * SCROLLBACK_LINES lines, so the lines that scroll off the top stay
+ * around to be looked at again. Each line remembers the range of
+ * columns written since it was last put on the display, and
+ * console_end draws just those, for the foreground only. A console
+ * in the background never touches the display, so it costs no more
+ * to print on than memory does. Switching consoles draws the screen
+ * of the new one from its shadow.
+ *
+ * The display has room for more lines than fit on the screen.
+ * Scrolling moves the start of what is shown down by a line, so only
+ * the new bottom line has to be drawn. When the bottom of the display
+ * memory is reached the screen is redrawn at its beginning.
+ *
+ * The display starts out as the VGA in text mode, where a cell, which
+ * is a character and its attribute, is a single store to video memory
+ * and the start is that of the CRT controller. The video memory is
+ * uncached, so every access to it costs a bus cycle. A framebuffer
+ * can take over later with console_set_display.
+ *
+ * Console 0 is the kernel console, which printf and the kernel log
+ * write to.
+ */
+
+#include <sys/types.h>
+#include <nodes/spinlock.h>
+#include <nodes/log.h>
+#include <asm/io.h>
+#include <io.h>
+
+
+#define VIDEO_BASE  0xb8000
+#define VIDEO_SIZE  0x8000    /* Bytes of text memory */
+
+#define CRTC_INDEX  0x3d4
+#define CRTC_DATA   0x3d5
+#define CRTC_START_HI   0x0c
+#define CRTC_START_LO   0x0d
+#define CRTC_CURSOR_HI  0x0e
+#define CRTC_CURSOR_LO  0x0f
+
+#define SCROLLBACK_LINES  256    /* A power of two */
+#define LINE(n)  ( (n) & (SCROLLBACK_LINES - 1))
+
+struct vc {
+	screen scr;
+
+	u16_t shadow[SCROLLBACK_LINES][MAX_COLS];
+
+	/* The dirty columns of each line. Clean when lo > hi. */
+	u8_t dirty_lo[SCROLLBACK_LINES], dirty_hi[SCROLLBACK_LINES];
+};
+
+static struct vc vcs[NR_CONSOLES];
+
+static struct vc *fg = &vcs[0];   /* The one on the display */
+
+static struct display *display;
+static u32_t origin;              /* The display line on top */
+
+/* Where a display that draws its own cursor last drew it */
+static u32_t cursor_line, cursor_col, cursor_shown;
+
+static DEFINE_SPINLOCK (console_lock);
+
+
+static inline u16_t blank (struct vc *vc)
+{
+	return (vc->scr.attribute << 8) | ' ';
+}
+
+
+static void crtc_write (u8_t reg, u16_t val)
+{
+	outb (reg, CRTC_INDEX);
+	outb (val >> 8, CRTC_DATA);
+	outb (reg + 1, CRTC_INDEX);
+	outb (val & 0xff, CRTC_DATA);
+}
+
+
+/* =============== The VGA text display =============== */
+
+static volatile u16_t *video = (volatile u16_t *) VIDEO_BASE;
+
+static void text_draw (u32_t line, u32_t col, const u16_t *cells, u32_t n);
+static void text_set_origin (u32_t line);
+static void text_cursor (u32_t line, u32_t col, u16_t cell);
+
+static struct display text_display = {
+	"vga", 0, 0, 0, 0, text_draw, text_set_origin, text_cursor
+};
+
+static void text_draw (u32_t line, u32_t col, const u16_t *cells, u32_t n)
+{
+	volatile u16_t *dst = video + line * text_display.cols + col;
+
+	while (n--) *dst++ = *cells++;
+}
+
+static void text_set_origin (u32_t line)
+{
+	crtc_write (CRTC_START_HI, line * text_display.cols);
+}
+
+static void text_cursor (u32_t line, u32_t col, u16_t cell)
+{
+	crtc_write (CRTC_CURSOR_HI, line * text_display.cols + col);
+}
+
+
+/* =============== The consoles =============== */
+
+static inline void mark_dirty (struct vc *vc, u32_t line, u32_t lo, u32_t hi)
+{
+	line = LINE (line);
+
+	if (vc->dirty_lo[line] > vc->dirty_hi[line]){
+		vc->dirty_lo[line] = lo;
+		vc->dirty_hi[line] = hi;
+		return;
+	}
+
+	if (lo < vc->dirty_lo[line]) vc->dirty_lo[line] = lo;
+	if (hi > vc->dirty_hi[line]) vc->dirty_hi[line] = hi;
+}
+
+
+static void clear_line (struct vc *vc, u32_t line)
+{
+	u16_t *p = vc->shadow[LINE (line)];
+	u16_t b = blank (vc);
+	u32_t i;
+
+	for (i = 0; i < vc->scr.cols; i++) p[i] = b;
+
+	mark_dirty (vc, line, 0, vc->scr.cols - 1);
+}
+
+
+/* Mark everything in view dirty */
+
+static void redraw (struct vc *vc)
+{
+	u32_t r;
+
+	for (r = 0; r < vc->scr.rows; r++)
+		mark_dirty (vc, vc->scr.top - vc->scr.back + r, 0,
+			    vc->scr.cols - 1);
+}
+
+
+/* Move the screen down by a line. The new bottom line is blank. Only
+ * the foreground moves the display along. */
+
+static void scroll (struct vc *vc)
+{
+	vc->scr.top++;
+	clear_line (vc, vc->scr.top + vc->scr.rows - 1);
+
+	if (vc != fg) return;
+
+	if (++origin + vc->scr.rows > display->lines){
+		origin = 0;
+		redraw (vc);
+	}
+
+	display->set_origin (origin);
+}
+
+
+static void newline (struct vc *vc)
+{
+	vc->scr.ypos = 0;
+
+	if (vc->scr.xpos + 1 < vc->scr.rows) vc->scr.xpos++;
+	else scroll (vc);
+}
+
+
+/* Draw the dirty cells of the lines of the foreground in view and
+ * move the cursor */
+
+static void flush (void)
+{
+	screen *scr = &fg->scr;
+	u32_t r, line, col;
+
+	/* The cell under the old cursor has to be drawn plain again */
+	if (display->soft_cursor && cursor_shown){
+		mark_dirty (fg, cursor_line, cursor_col, cursor_col);
+		cursor_shown = 0;
+	}
+
+	for (r = 0; r < scr->rows; r++){
+		line = LINE (scr->top - scr->back + r);
+		if (fg->dirty_lo[line] > fg->dirty_hi[line]) continue;
+
+		display->draw (origin + r, fg->dirty_lo[line],
+			       &fg->shadow[line][fg->dirty_lo[line]],
+			       fg->dirty_hi[line] - fg->dirty_lo[line] + 1);
+
+		fg->dirty_lo[line] = MAX_COLS;
+		fg->dirty_hi[line] = 0;
+	}
+
+	if (scr->back) return;
+
+	col = scr->ypos < scr->cols ? scr->ypos : scr->cols - 1;
+	line = scr->top + scr->xpos;
+
+	display->cursor (origin + scr->xpos, col, fg->shadow[LINE (line)][col]);
+
+	cursor_line = line;
+	cursor_col = col;
+	cursor_shown = 1;
+}
+
+
+static void vc_putc (struct vc *vc, char c)
+{
+	screen *scr = &vc->scr;
+	u32_t line;
+
+	if (scr->back){
+		scr->back = 0;
+		redraw (vc);
+	}
+
+	if ( c == '\n' || c == '\r'){
+		newline (vc);
+		return;
+	}
+
+	if ( c == '\t' ){
+		scr->ypos = (scr->ypos + 8) & ~7;
+		if (scr->ypos >= scr->cols) newline (vc);
+		return;
+	}
+
+	if ( scr->ypos >= scr->cols ) newline (vc);
+
+	line = scr->top + scr->xpos;
+	vc->shadow[LINE (line)][scr->ypos] = (scr->attribute << 8) | (u8_t) c;
+	mark_dirty (vc, line, scr->ypos, scr->ypos);
+	scr->ypos++;
+}
+
+
+/* Runs of plain characters go straight into the shadow line and are
+ * marked dirty once; the rest is left to vc_putc. */
+
+static void __vc_write (struct vc *vc, const char *s, u32_t n)
+{
+	screen *scr = &vc->scr;
+	u16_t *p, attr = scr->attribute << 8;
+	u32_t line, start, end;
+
+	while (n){
+		if (scr->back || scr->ypos >= scr->cols ||
+		    *s == '\n' || *s == '\r' || *s == '\t'){
+			vc_putc (vc, *s++);
+			n--;
+			continue;
+		}
+
+		line = scr->top + scr->xpos;
+		p = vc->shadow[LINE (line)];
+		start = end = scr->ypos;
+
+		while (n && end < scr->cols &&
+		       *s != '\n' && *s != '\r' && *s != '\t'){
+			p[end++] = attr | (u8_t) *s++;
+			n--;
+		}
+
+		mark_dirty (vc, line, start, end - 1);
+		scr->ypos = end;
+	}
+}
+
+
+u32_t console_begin (void)
+{
+	u32_t flags;
+
+	spin_lock_irqsave (&console_lock, flags);
+	return flags;
+}
+
+
+void console_end (u32_t flags)
+{
+	flush();
+	spin_unlock_irqrestore (&console_lock, flags);
+}
+
+
+/* Put character `c' on the kernel console at the cursor and move the
+ * cursor on. The console is held. */
+
+void console_putc (char c)
+{
+	vc_putc (&vcs[0], c);
+}
+
+
+/* Put `n' characters from `s' on the kernel console, which is held */
+
+void console_write (const char *s, u32_t n)
+{
+	__vc_write (&vcs[0], s, n);
+}
+
+
+void vc_write (u32_t console, const char *s, u32_t n)
+{
+	u32_t flags = console_begin();
+
+	__vc_write (&vcs[console], s, n);
+	console_end (flags);
+}
+
+
+void putchar (char c)
+{
+	u32_t flags = console_begin();
+
+	console_putc (c);
+	console_end (flags);
+}
+
+
+u32_t console_foreground (void)
+{
+	return fg - vcs;
+}
+
+
+/* Bring `console' to the foreground. The display starts again from
+ * its top, so there is one screen to draw. */
+
+void console_switch (u32_t console)
+{
+	u32_t flags;
+
+	if (console >= NR_CONSOLES) return;
+
+	flags = console_begin();
+
+	if (&vcs[console] != fg){
+		fg = &vcs[console];
+		cursor_shown = 0;
+		origin = 0;
+		display->set_origin (0);
+		redraw (fg);
+	}
+
+	console_end (flags);
+}
+
+
+void console_scroll (int lines)
+{
+	u32_t flags = console_begin();
+	screen *scr = &fg->scr;
+	int back = scr->back + lines;
+	int most = scr->top < SCROLLBACK_LINES - scr->rows ?
+		scr->top : SCROLLBACK_LINES - scr->rows;
+
+	if (back < 0) back = 0;
+	if (back > most) back = most;
+
+	if (back != scr->back){
+		scr->back = back;
+		redraw (fg);
+	}
+
+	console_end (flags);
+}
+
+
+/* Clear the kernel console. The lines on it stay in the history. */
+
+void cls (void)
+{
+	u32_t flags = console_begin();
+	struct vc *vc = &vcs[0];
+	u32_t r;
+
+	vc->scr.back = 0;
+
+	for (r = 0; r < vc->scr.rows; r++) scroll (vc);
+
+	vc->scr.xpos = 0;
+	vc->scr.ypos = 0;
+
+	console_end (flags);
+}
+
+
+#ifdef CONFIG_BENCH
+
+static u32_t legacy_col;
+
+/* What putchar did before there was a shadow: a byte store each for
+ * the character and its attribute, straight into video memory. It
+ * writes the display line just below the screen, which is drawn from
+ * the shadow in full before it scrolls into view, so the benchmark
+ * leaves no marks. */
+
+void legacy_putchar (char c)
+{
+	volatile u8_t *cell;
+	u32_t line = origin + fg->scr.rows;
+
+	if (line >= text_display.lines) line = 0;
+
+	if (c == '\n' || legacy_col >= text_display.cols){
+		legacy_col = 0;
+		if (c == '\n') return;
+	}
+
+	cell = (volatile u8_t *) (video + line * text_display.cols + legacy_col++);
+	cell[0] = c;
+	cell[1] = fg->scr.attribute;
+}
+
+#endif /* CONFIG_BENCH */
+
+
+/* The kernel console as a sink of the kernel log */
+
+static void console_log_write (const char *s, u32_t n)
+{
+	u32_t flags = console_begin();
+
+	console_write (s, n);
+	console_end (flags);
+}
+
+static struct log_sink console_sink = {
+	"console", console_log_write, LOG_INFO
+};
+
+
+/* Set up all the consoles with `rows' and `cols' of text in
+ * `attribute', on the VGA text display */
+
+void init_screen( unsigned int rows,
+		 unsigned int cols, 
+		 char attribute)
+{
+	struct vc *vc;
+	u32_t r, flags;
+
+	if (cols > MAX_COLS) cols = MAX_COLS;
+
+	text_display.rows = rows;
+	text_display.cols = cols;
+	text_display.lines = VIDEO_SIZE / 2 / cols;
+	display = &text_display;
+
+	flags = console_begin();
+
+	for (vc = vcs; vc < vcs + NR_CONSOLES; vc++){
+		vc->scr.rows = rows;
+		vc->scr.cols = cols;
+		vc->scr.attribute = attribute;
+
+		vc->scr.xpos = 0;
+		vc->scr.ypos = 0;
+		vc->scr.top = 0;
+		vc->scr.back = 0;
+
+		for (r = 0; r < SCROLLBACK_LINES; r++){
+			vc->dirty_lo[r] = MAX_COLS;
+			vc->dirty_hi[r] = 0;
+		}
+
+		for (r = 0; r < rows; r++) clear_line (vc, r);
+	}
+
+	origin = 0;
+	display->set_origin (0);
+
+	console_end (flags);
+
+	register_log_sink (&console_sink);
+}
+
+
+/* Show the consoles on `d' from now on. The history is kept. Lines
+ * get blank cells out to the new width and the cursor stays on the
+ * line it was on. */
+
+void console_set_display (struct display *d)
+{
+	u32_t flags = console_begin();
+	u32_t cols = d->cols < MAX_COLS ? d->cols : MAX_COLS;
+	struct vc *vc;
+	screen *scr;
+	u32_t r, c;
+	u16_t b;
+
+	for (vc = vcs; vc < vcs + NR_CONSOLES; vc++){
+		scr = &vc->scr;
+		b = blank (vc);
+
+		for (r = 0; r < SCROLLBACK_LINES; r++)
+			for (c = scr->cols; c < cols; c++) vc->shadow[r][c] = b;
+
+		/* Rows that are new at the bottom may still hold old
+		 * history */
+		for (r = scr->rows; r < d->rows; r++)
+			clear_line (vc, scr->top + r);
+
+		scr->cols = cols;
+		scr->rows = d->rows;
+		scr->back = 0;
+
+		if (scr->xpos >= scr->rows){
+			scr->top += scr->xpos - scr->rows + 1;
+			scr->xpos = scr->rows - 1;
+		}
+		if (scr->ypos > scr->cols) scr->ypos = scr->cols;
+	}
+
+	display = d;
+	cursor_shown = 0;
+	origin = 0;
+	display->set_origin (0);
+	redraw (fg);
+
+	console_end (flags);
+}
@@ -0,0 +1,175 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     arch/i386/kernel/apic.c
+ * Description:   Local APIC and local APIC timer support.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/time.h>
+#include <asm/apic.h>
+#include <asm/timer.h>
+#include <asm/interrupt.h>
+#include <asm/msr.h>
+#include <asm/div64.h>
+#include <asm/mm.h>
+#include <mm/mm.h>
+#include <io.h>
+
+
+/* The local APIC entry points in irq.S */
+void _apic_timer_hdl (void);
+void _apic_spurious_hdl (void);
+
+
+volatile u32_t *lapic;
+
+static u32_t apic_ticks_per_jiffy;  /* Timer counts per tick, at a
+				     * divisor of 16 */
+
+
+/* Detect the local APIC through cpuid, map its registers and software
+ * enable it. The PIC stays in charge of the device irqs, the APIC
+ * gives us its timer and the interprocessor interrupts.
+ */
+
+int init_apic (void)
+{
+	u32_t base;
+
+	if ( !(cpu_features() & CPUID_APIC)) return 0;
+
+	base = (u32_t) rdmsr (MSR_IA32_APIC_BASE) & ~0xfff;
+
+	lapic = ioremap (base, PAGE_SIZE_BYTES, CACHE_DISABLE);
+	if (!lapic) return 0;
+
+	set_intr_gate (LOCAL_TIMER_VECTOR, _apic_timer_hdl);
+	set_intr_gate (SPURIOUS_VECTOR, _apic_spurious_hdl);
+
+	apic_write (APIC_SPURIOUS, APIC_SW_ENABLE | SPURIOUS_VECTOR);
+
+	return 1;
+}
+
+
+/* All processors find their own local APIC at the same address, so
+ * the mapping of the boot processor works for them too. Their timers
+ * run at the same rate, so the calibration does too. If the boot
+ * processor had no use for the APIC timer the others get no tick and
+ * only run when an interrupt wakes them.
+ */
+
+void init_apic_secondary (void)
+{
+	apic_write (APIC_SPURIOUS, APIC_SW_ENABLE | SPURIOUS_VECTOR);
+	apic_write (APIC_TPR, 0);
+
+	if (!apic_ticks_per_jiffy) return;
+
+	apic_write (APIC_TIMER_DIV, APIC_TIMER_DIV16);
+	apic_write (APIC_LVT_TIMER, LOCAL_TIMER_VECTOR | APIC_TIMER_PERIODIC);
+	apic_write (APIC_TIMER_INIT, apic_ticks_per_jiffy);
+}
+
+
+void apic_send_ipi (u32_t dest, u32_t icr)
+{
+	apic_write (APIC_ICR_HIGH, dest << 24);
+	apic_write (APIC_ICR_LOW, icr);
+
+	while (apic_read (APIC_ICR_LOW) & APIC_ICR_BUSY)
+		;
+}
+
+
+static void apic_set_periodic (void)
+{
+	apic_write (APIC_LVT_TIMER, APIC_TIMER_PERIODIC | LOCAL_TIMER_VECTOR);
+	apic_write (APIC_TIMER_INIT, apic_ticks_per_jiffy);
+}
+
+
+static void apic_set_next_event (u64_t delta_ns)
+{
+	u64_t count = delta_ns * apic_ticks_per_jiffy;
+
+	do_div (&count, TICK_NSEC);
+	if (count == 0) count = 1;
+
+	apic_write (APIC_LVT_TIMER, LOCAL_TIMER_VECTOR);
+	apic_write (APIC_TIMER_INIT, (u32_t) count);
+}
+
+
+static struct clock_event apic_clock_event = {
+	"local APIC", 0, apic_set_periodic, apic_set_next_event
+};
+
+
+/* Count how far the APIC timer gets in 10 ms of PIT time and start it
+ * in periodic mode with a tick's worth of that.
+ */
+
+struct clock_event *apic_timer_setup (void)
+{
+	u32_t elapsed;
+
+	apic_write (APIC_TIMER_DIV, APIC_TIMER_DIV16);
+	apic_write (APIC_LVT_TIMER, APIC_LVT_MASKED | LOCAL_TIMER_VECTOR);
+	apic_write (APIC_TIMER_INIT, 0xffffffff);
+
+	pit_wait (PIT_HZ / 100);
+
+	elapsed = 0xffffffff - apic_read (APIC_TIMER_CURR);
+	apic_ticks_per_jiffy = elapsed * 100 / HZ;
+
+	apic_clock_event.max_delta_ns = (u64_t) (0xffffffff / apic_ticks_per_jiffy)
+		* TICK_NSEC;
+
+	apic_set_periodic();
+
+	return &apic_clock_event;
+}
+
+
+/* Called from _apic_timer_hdl in irq.S */
+
+void apic_timer_interrupt (struct irq_frame *frame)
+{
+	struct irq_frame *old_frame = set_irq_frame (frame);
+
+	timer_tick();
+	apic_eoi();
+
+	set_irq_frame (old_frame);
+}
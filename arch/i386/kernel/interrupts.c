@@ -37,6 +37,13 @@
 #include <asm/interrupt.h>
 #include <asm/io.h>
 #include <io.h>
+#include <nodes/sched.h>
+#include <asm/atomic.h>
+#include <asm/percpu.h>
+#include <asm/smp.h>
+#include <nodes/spinlock.h>
+#include <nodes/log.h>
+#include <nodes/trace.h>
 
 
 /* Forward declarations ofthe generic irq handlers defined in irq.S */
@@ -61,50 +68,254 @@ void _irq15_hdl (void);
 /* A table for the 16 irq's */
 static irq_t irq_table[NUM_OF_IRQS]; 
 
+/* One lock per line guards its handler chain and mask count. It is
+ * held while the hard handlers run, so free_irq never unlinks an
+ * action under a running handler. */
+static spinlock_t irq_locks[NUM_OF_IRQS];
 
-/* Set a handler for a particular irq number */
+/* "irqN.lock", the name of each in the lock statistics */
+static char irq_lock_names[NUM_OF_IRQS][12];
 
-void set_irq_handler (u32_t irq_num, int_handler_t handler)
+/* The mask registers of the two PICs are read-modify-written */
+static DEFINE_SPINLOCK (i8259_mask_lock);
+
+static void irq_thread (void *arg);
+
+/* Interrupts seen on each line, counted by the processor that took
+ * them so the hot path never writes a shared cache line */
+static DEFINE_PER_CPU (u32_t [NUM_OF_IRQS], irq_counts);
+
+
+u32_t irq_count (u32_t irq_num)
 {
+	u32_t cpu, count = 0;
+
+	for (cpu = 0; cpu < num_online_cpus; cpu++)
+		count += per_cpu (irq_counts, cpu)[irq_num];
 
+	return count;
+}
+
+
+/* Add `action' to the end of the handler chain of irq `irq_num'. The
+ * handlers on a line are called in the order they were registered.
+ */
+
+int request_irq (u32_t irq_num, struct irq_action *action)
+{
 	irq_t *irq;
+	struct irq_action **p;
+	u32_t flags;
 
 	if (irq_num >= NUM_OF_IRQS){
-		printf ("ERROR: Invalid irq number : %d\n", irq_num);
-		return;
+		printk (LOG_ERR, "ERROR: Invalid irq number : %d\n", irq_num);
+		return -1;
 	}
 
+	if (!action->handler && !action->thread_fn){
+		printk (LOG_ERR, "ERROR: No handler for irq number : %d\n", irq_num);
+		return -1;
+	}
 
 	irq = &irq_table[irq_num];
 
-	if ( irq->num_of_isrs >= MAX_SHARED_INTERRUPTS ){
-		printf ("Error: Too many devices sharing irq number : %d\n", irq->num);
+	action->irq = irq_num;
+	action->thread_pending = 0;
+	action->thread_stop = 0;
+	action->thread = 0;
+	action->next = 0;
+
+	if (action->thread_fn){
+		action->thread = kthread_create (irq_thread, action, action->name);
+		if (!action->thread){
+			printk (LOG_ERR, "ERROR: No thread for irq number : %d\n", irq_num);
+			return -1;
+		}
+		set_task_prio (action->thread, IRQ_THREAD_PRIO);
 	}
-	else{
-		irq->isr[irq->num_of_isrs++] = handler;
+
+	spin_lock_irqsave (&irq_locks[irq_num], flags);
+
+	for (p = &irq->action; *p; p = &(*p)->next)
+		;
+	*p = action;
+
+	if (irq->action == action && !irq->masked) enable_irq (irq_num);
+
+	spin_unlock_irqrestore (&irq_locks[irq_num], flags);
+
+	return 0;
+}
+
+
+/* Unlink the handler whose cookie is `dev' from the chain of irq
+ * `irq_num'. If it is threaded, its thread is told to exit and we
+ * wait until it has, so `action' is free for the caller to reuse
+ * once we return. Only the thread lets go of the mask it holds; it
+ * may be inside thread_fn right now. Must be called from a thread,
+ * but not from the thread_fn of the handler being freed.
+ */
+
+void free_irq (u32_t irq_num, void *dev)
+{
+	irq_t *irq;
+	struct irq_action **p, *action, *found = 0;
+	u32_t flags;
+
+	if (irq_num >= NUM_OF_IRQS) return;
+
+	irq = &irq_table[irq_num];
+
+	spin_lock_irqsave (&irq_locks[irq_num], flags);
+
+	for (p = &irq->action; *p; p = &(*p)->next){
+		action = *p;
+		if (action->dev != dev) continue;
+
+		*p = action->next;
+		found = action;
+
+		if (action->thread){
+			action->thread_stop = 1;
+			wake_up_task (action->thread);
+		}
+		break;
+	}
+
+	if (!irq->action) disable_irq (irq_num);
+
+	spin_unlock_irqrestore (&irq_locks[irq_num], flags);
+
+	/* The thread clears `thread' as the last thing it does with
+	 * `action' */
+	if (found)
+		while (load_acquire (&found->thread))
+			yield();
+}
+
+
+/* Mask the line and wake the thread of `action'. The line stays
+ * masked until every threaded handler on it has run. The line lock
+ * is held.
+ */
+
+static void irq_wake_thread (irq_t *irq, struct irq_action *action)
+{
+	if (action->thread_pending) return;
+
+	action->thread_pending = 1;
+	if (irq->masked++ == 0) disable_irq (irq->num);
+
+	wake_up_task (action->thread);
+}
+
+
+/* The body of the thread of a threaded handler. Sleeps until the hard
+ * handler wakes it, runs thread_fn with interrupts enabled and unmasks
+ * the line. When free_irq tells it to stop it gives back the mask it
+ * may still hold and exits. The line stays masked if free_irq took
+ * the last handler off it.
+ */
+
+static void irq_thread (void *arg)
+{
+	struct irq_action *action = arg;
+	irq_t *irq = &irq_table[action->irq];
+	u32_t flags;
+
+	for (;;){
+		/* Mark ourselves blocked before looking, so a wakeup
+		 * from another processor in between is not lost. */
+		for (;;){
+			current->state = TASK_BLOCKED;
+			mb();
+			if (action->thread_pending || action->thread_stop)
+				break;
+			schedule();
+		}
+		current->state = TASK_RUNNING;
+
+		if (!action->thread_stop)
+			action->thread_fn (action->irq, action->dev);
+
+		spin_lock_irqsave (&irq_locks[action->irq], flags);
+		if (action->thread_pending){
+			action->thread_pending = 0;
+			if (--irq->masked == 0 && irq->action)
+				enable_irq (action->irq);
+		}
+		spin_unlock_irqrestore (&irq_locks[action->irq], flags);
+
+		if (action->thread_stop) break;
 	}
 
+	store_release (&action->thread, 0);
+}
+
+
+static DEFINE_PER_CPU (struct irq_frame *, irq_frame);
+
+struct irq_frame *get_irq_frame (void)
+{
+	return this_cpu_read (irq_frame);
+}
+
+struct irq_frame *set_irq_frame (struct irq_frame *frame)
+{
+	struct irq_frame *old = this_cpu_read (irq_frame);
+
+	this_cpu_write (irq_frame, frame);
+	return old;
 }
 
+
 /* This fuction is called from the _irqN_hdl functions which are
- * stored in the idt (see irq.S). It retrieves the irq_t structure for the
- * particular irq to be handled and then uses the information to call
- * each registered ISR in turn.
+ * stored in the idt (see irq.S). It walks the chain of handlers of
+ * the irq and stops at the first one that claims the interrupt, so a
+ * busy device early in the chain does not pay for the ones behind it.
+ * `frame' is what the interrupted code had in its registers.
  */
 
-void handle_irq (u32_t irq_num)
+void handle_irq (u32_t irq_num, struct irq_frame *frame)
 {
 	irq_t *irq = &irq_table[irq_num];
+	struct irq_action *action;
+	struct irq_frame *old_frame = set_irq_frame (frame);
+	int ret = IRQ_NONE;
 
-       	if (irq->num_of_isrs == 0) printf ("Error: No ISR's registered for irq %d\n", irq_num);
-	else{
-		int i;
-		int_handler_t isr;
-		for (i = 0; i < irq->num_of_isrs ; i++){
-			isr = irq->isr[i];
-			isr();
+	per_cpu (irq_counts, smp_processor_id())[irq_num]++;
+
+	trace (TRACE_IRQ_ENTRY, irq_num, 0, 0);
+
+	/* Interrupts are already off in here */
+	raw_spin_lock (&irq_locks[irq_num]);
+
+	if (!irq->action){
+		raw_spin_unlock (&irq_locks[irq_num]);
+		printk (LOG_ERR, "Error: No ISR's registered for irq %d\n", irq_num);
+		goto traced;
+	}
+
+	for (action = irq->action; action; action = action->next){
+
+		ret = action->handler ? action->handler (irq_num, action->dev)
+			: IRQ_WAKE_THREAD;
+
+		if (ret == IRQ_HANDLED) goto out;
+
+		if (ret == IRQ_WAKE_THREAD){
+			irq_wake_thread (irq, action);
+			goto out;
 		}
 	}
+
+	irq->unhandled++;
+ out:
+	raw_spin_unlock (&irq_locks[irq_num]);
+ traced:
+	trace (TRACE_IRQ_EXIT, irq_num, ret, 0);
+
+	set_irq_frame (old_frame);
 }
 
 
@@ -121,7 +332,7 @@ void handle_irq (u32_t irq_num)
  */
 
 
-static void 
+void 
 set_intr_gate (u16_t vector, int_handler_t handler)
 {								
 	__asm__ __volatile__ ("movl %%ebx, %%eax\n\t"	
@@ -174,8 +385,12 @@ void init_interrupts(void)
 
 	for (i = 0; i < NUM_OF_IRQS; i++){
 		irq = &irq_table[i];
-		irq->num_of_isrs = 0;
+		irq->action = 0;
 		irq->num = i;
+		irq->masked = 0;
+		snprintf (irq_lock_names[i], sizeof (irq_lock_names[i]),
+			  "irq%u.lock", i);
+		__spin_lock_init (&irq_locks[i], irq_lock_names[i]);
 
 		disable_irq(i);
 	}
@@ -189,6 +404,10 @@ void init_interrupts(void)
 
 void enable_irq (u32_t irq)
 {
+	u32_t flags;
+
+	spin_lock_irqsave (&i8259_mask_lock, flags);
+
 	if ( irq < 8) {
 		outb ( inb(INT_CTLMASK) & ~(1 << irq), INT_CTLMASK);
 	}
@@ -196,6 +415,8 @@ void enable_irq (u32_t irq)
 		irq -= 8;
 		outb ( inb(INT2_CTLMASK) & ~(1 << irq), INT2_CTLMASK);
 	}
+
+	spin_unlock_irqrestore (&i8259_mask_lock, flags);
 }
 
 
@@ -203,9 +424,15 @@ void enable_irq (u32_t irq)
 
 void disable_irq (u32_t irq)
 {
+	u32_t flags;
+
+	spin_lock_irqsave (&i8259_mask_lock, flags);
+
 	if (irq < 8 ) outb( inb(INT_CTLMASK) | ( 1 << irq), INT_CTLMASK);
 	else{
 		irq -= 8;
 		outb ( inb(INT2_CTLMASK) | ( 1 << irq), INT2_CTLMASK);
 	}
+
+	spin_unlock_irqrestore (&i8259_mask_lock, flags);
 }
@@ -0,0 +1,453 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     arch/i386/kernel/smp.c
+ * Description:   Finding and starting the application processors.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* The BIOS describes the processors in the tables of the Intel
+ * MultiProcessor Specification. We look for the floating pointer
+ * structure in the usual three places, follow it to the configuration
+ * table and collect the local APIC ids of the processors that are
+ * enabled.
+ *
+ * Every application processor is then started on its own: we set up
+ * its idle task, whose stack it boots on, and its own copy of the GDT,
+ * and send it the INIT, startup, startup sequence of IPIs. It comes up
+ * in trampoline.S, switches to protected mode and paging and ends up
+ * in start_secondary, which marks it online and makes it idle. All
+ * processors share the IDT.
+ *
+ * Device interrupts still all go to the boot processor through the
+ * PIC. The others only see their local APIC timer and the reschedule
+ * IPI.
+ *
+ * Every processor, the boot processor included, gets a copy of the
+ * per processor variables and a GS segment pointing at it (see
+ * asm/percpu.h).
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/sched.h>
+#include <nodes/time.h>
+#include <asm/smp.h>
+#include <asm/percpu.h>
+#include <asm/apic.h>
+#include <asm/gdt.h>
+#include <asm/interrupt.h>
+#include <asm/atomic.h>
+#include <asm/mm.h>
+#include <mm/mm.h>
+#include <io.h>
+#include <nodes/log.h>
+
+
+struct cpu_info cpu_data[NR_CPUS];
+
+u32_t num_online_cpus = 1;
+
+u32_t __per_cpu_offset[NR_CPUS];
+
+DEFINE_PER_CPU (u32_t, cpu_number);
+DEFINE_PER_CPU (u32_t, this_cpu_off);
+
+
+/* Give processor `cpu' a copy of the per processor template and a GDT
+ * with a segment that reaches it. A page is more than enough room and
+ * is aligned to a cache line. Returns 0 if there is no memory. */
+
+static int setup_cpu_area (u32_t cpu)
+{
+	struct cpu_info *c = &cpu_data[cpu];
+	u32_t size = __per_cpu_end - __per_cpu_start;
+	u8_t *area;
+	u32_t i;
+
+	if (size > PAGE_SIZE_BYTES){
+		printf ("per cpu area too large : %d bytes\n", size);
+		return 0;
+	}
+
+	area = (u8_t *) allocate_page (LOW_MEM_ZONE);
+	if (!area) return 0;
+
+	for (i = 0; i < size; i++)
+		area[i] = __per_cpu_start[i];
+
+	__per_cpu_offset[cpu] = (u32_t) area - (u32_t) __per_cpu_start;
+	per_cpu (cpu_number, cpu) = cpu;
+	per_cpu (this_cpu_off, cpu) = __per_cpu_offset[cpu];
+
+	for (i = 0; i < GDT_PERCPU; i++)
+		c->gdt[i] = __gdt[i];
+
+	set_seg_desc ( (u32_t *) &c->gdt[GDT_PERCPU], 0, D_RW,
+		       __per_cpu_offset[cpu], 0xfffff);
+
+	return 1;
+}
+
+
+/* Load the GDT of processor `cpu' and point GS at its variables */
+
+static void load_cpu_segments (u32_t cpu)
+{
+	load_gdt (cpu_data[cpu].gdt, GDT_ENTRIES);
+
+	__asm__ __volatile__ ("movw %w0, %%gs" :: "r" (PERCPU_SEL));
+}
+
+
+void setup_per_cpu_areas (void)
+{
+	if (!setup_cpu_area (0)){
+		printf ("Can not set up the per cpu area\n");
+		for (;;)
+			;
+	}
+
+	load_cpu_segments (0);
+
+	enable_page_magazines();
+}
+
+
+#ifdef CONFIG_SMP
+
+/* In trampoline.S */
+extern u8_t trampoline_start[], trampoline_end[];
+extern u8_t tr_gdt_ptr[], tr_pg_dir[], tr_stack[];
+
+extern u32_t kernel_pg_dir[];
+
+void _reschedule_hdl (void);
+
+
+/* The MP floating pointer structure */
+struct mp_floating {
+	char signature[4];        /* "_MP_" */
+	u32_t config;             /* Physical address of the
+				   * configuration table */
+	u8_t length;              /* In 16 byte units */
+	u8_t spec_rev;
+	u8_t checksum;
+	u8_t feature1;            /* Default configuration, if not 0 */
+	u8_t feature2;
+	u8_t reserved[3];
+} __attribute__ ((packed));
+
+/* The header of the MP configuration table */
+struct mp_config {
+	char signature[4];        /* "PCMP" */
+	u16_t length;
+	u8_t spec_rev;
+	u8_t checksum;
+	char oem[8];
+	char product[12];
+	u32_t oem_table;
+	u16_t oem_size;
+	u16_t count;              /* Number of entries after us */
+	u32_t lapic;
+	u16_t ext_length;
+	u8_t ext_checksum;
+	u8_t reserved;
+} __attribute__ ((packed));
+
+#define MP_PROCESSOR  0   /* Entry type, 20 bytes long. The others
+			   * are 8. */
+
+struct mp_processor {
+	u8_t type;
+	u8_t apic_id;
+	u8_t apic_ver;
+	u8_t flags;
+	u32_t signature;
+	u32_t features;
+	u32_t reserved[2];
+} __attribute__ ((packed));
+
+#define CPU_ENABLED   1   /* In mp_processor.flags */
+
+
+static u32_t num_cpus = 1;   /* Processors found, online or not */
+
+
+static int mp_checksum (u8_t *p, u32_t len)
+{
+	u8_t sum = 0;
+
+	while (len--) sum += *p++;
+
+	return sum == 0;
+}
+
+
+static struct mp_floating *mp_scan (u32_t base, u32_t len)
+{
+	u32_t *p;
+
+	for (p = (u32_t *) base; len >= 16; p += 4, len -= 16){
+		if (*p == ('_' | ('M' << 8) | ('P' << 16) | ('_' << 24)) &&
+		    mp_checksum ( (u8_t *) p, 16))
+			return (struct mp_floating *) p;
+	}
+
+	return 0;
+}
+
+
+/* The floating pointer is in the first KB of the extended BIOS data
+ * area, in the last KB of base memory or in the BIOS ROM. The pointer
+ * to the EBDA is in the BIOS data area in page 0, which we keep
+ * unmapped to catch null pointers. The EBDA sits at the top of base
+ * memory anyway, so the last KB covers it. */
+
+static struct mp_floating *find_mp_floating (void)
+{
+	struct mp_floating *mpf;
+
+	if ( (mpf = mp_scan (0x9FC00, 1024)))
+		return mpf;
+
+	return mp_scan (0xF0000, 0x10000);
+}
+
+
+static void add_cpu (u32_t apic_id)
+{
+	if (apic_id == cpu_data[0].apic_id) return;
+
+	if (num_cpus == NR_CPUS){
+		printk (LOG_WARNING, "SMP: ignoring processor %d, NR_CPUS is %d\n",
+			apic_id, NR_CPUS);
+		return;
+	}
+
+	cpu_data[num_cpus++].apic_id = apic_id;
+}
+
+
+/* Fill cpu_data with the processors from the MP tables. Processor 0
+ * is always the one we are running on. */
+
+static void read_mp_tables (void)
+{
+	struct mp_floating *mpf;
+	struct mp_config *mpc;
+	struct mp_processor *proc;
+	u8_t *entry;
+	u32_t i;
+
+	mpf = find_mp_floating();
+	if (!mpf) return;
+
+	/* One of the default configurations, two processors */
+	if (mpf->feature1){
+		add_cpu (0);
+		add_cpu (1);
+		return;
+	}
+
+	if (!mpf->config) return;
+
+	mpc = (struct mp_config *) mpf->config;
+	if (mpf->config >= LOW_MEM_BOUNDARY &&
+	    !(mpc = ioremap (mpf->config, PAGE_SIZE_BYTES, 0)))
+		return;
+
+	if (mpc->signature[0] != 'P' || mpc->signature[1] != 'C' ||
+	    mpc->signature[2] != 'M' || mpc->signature[3] != 'P' ||
+	    !mp_checksum ( (u8_t *) mpc, mpc->length)){
+		printk (LOG_ERR, "SMP: bad MP configuration table\n");
+		return;
+	}
+
+	entry = (u8_t *) (mpc + 1);
+
+	for (i = 0; i < mpc->count; i++){
+		if (*entry != MP_PROCESSOR){
+			entry += 8;
+			continue;
+		}
+
+		proc = (struct mp_processor *) entry;
+		if (proc->flags & CPU_ENABLED)
+			add_cpu (proc->apic_id);
+
+		entry += sizeof (struct mp_processor);
+	}
+}
+
+
+/* Start processor `cpu' and wait up to a second for it to check in.
+ * The sequence and the delays are the ones from the MP
+ * specification. */
+
+static int boot_cpu (u32_t cpu)
+{
+	struct cpu_info *c = &cpu_data[cpu];
+	struct task *idle;
+	u32_t *gdt_ptr, i;
+
+	if (!setup_cpu_area (cpu)) return 0;
+
+	idle = fork_idle (cpu);
+	if (!idle) return 0;
+
+	gdt_ptr = (u32_t *) (TRAMPOLINE_BASE + (tr_gdt_ptr - trampoline_start));
+	*(u16_t *) gdt_ptr = GDT_ENTRIES * 8 - 1;
+	*(u32_t *) ( (u8_t *) gdt_ptr + 2) = phys_addr ( (u32_t) c->gdt);
+
+	*(u32_t *) (TRAMPOLINE_BASE + (tr_stack - trampoline_start)) =
+		(u32_t) idle + THREAD_SIZE;
+
+	wmb();
+
+	apic_send_ipi (c->apic_id, APIC_DM_INIT | APIC_LEVEL_ASSERT);
+	udelay (10000);
+
+	for (i = 0; i < 2; i++){
+		apic_send_ipi (c->apic_id, APIC_DM_STARTUP |
+			       (TRAMPOLINE_BASE >> 12));
+		udelay (200);
+	}
+
+	for (i = 0; i < 10000 && !c->online; i++)
+		udelay (100);
+
+	/* A processor that is only late could still come up on this
+	 * stack, so it is not freed. INIT puts it back to waiting for
+	 * a startup IPI, in case it is on its way. */
+	if (!c->online)
+		apic_send_ipi (c->apic_id, APIC_DM_INIT | APIC_LEVEL_ASSERT);
+
+	return c->online;
+}
+
+
+void smp_init (void)
+{
+	u32_t cpu, len;
+	u8_t *src, *dst;
+
+	if (!lapic) return;
+
+	cpu_data[0].apic_id = apic_id();
+	cpu_data[0].online = 1;
+
+	set_intr_gate (RESCHEDULE_VECTOR, _reschedule_hdl);
+
+	read_mp_tables();
+	if (num_cpus == 1) return;
+
+	/* Copy the trampoline to where the processors start */
+	src = trampoline_start;
+	dst = (u8_t *) TRAMPOLINE_BASE;
+	for (len = trampoline_end - trampoline_start; len; len--)
+		*dst++ = *src++;
+
+	*(u32_t *) (TRAMPOLINE_BASE + (tr_pg_dir - trampoline_start)) =
+		phys_addr ( (u32_t) kernel_pg_dir);
+
+	/* Processors are numbered in the order they come up, so the
+	 * online ones are always 0 to num_online_cpus - 1. We stop at
+	 * the first that does not come up. Starting the next one would
+	 * hand it the same number, per processor area and idle stack,
+	 * and rewrite the trampoline, under a processor that might
+	 * still be on its way through them despite the INIT. */
+	for (cpu = 1; cpu < num_cpus; cpu++){
+		cpu_data[num_online_cpus].apic_id = cpu_data[cpu].apic_id;
+
+		if (!boot_cpu (num_online_cpus)){
+			printk (LOG_ERR, "SMP: processor %d did not start, "
+				"not starting the rest\n", cpu_data[cpu].apic_id);
+			break;
+		}
+
+		num_online_cpus++;
+	}
+
+	printk (LOG_INFO, "SMP: %d processors online\n", num_online_cpus);
+}
+
+
+void smp_send_reschedule (u32_t cpu)
+{
+	apic_send_ipi (cpu_data[cpu].apic_id, APIC_DM_FIXED | RESCHEDULE_VECTOR);
+}
+
+
+#endif /* CONFIG_SMP */
+
+
+/* The entry points below are reached from trampoline.S and irq.S,
+ * which can not see the configuration, so they are always built. */
+
+static void load_idt (void)
+{
+	struct {
+		u16_t limit;
+		u32_t base;
+	} __attribute__ ((packed)) ptr = { sizeof (__idt) - 1, (u32_t) __idt };
+
+	__asm__ __volatile__ ("lidt %0" :: "m" (ptr));
+}
+
+
+/* An application processor gets here from trampoline.S, running on
+ * the stack of the idle task made for it, with interrupts disabled.
+ * Until GS is loaded the only way to tell who we are is that task. */
+
+void start_secondary (void)
+{
+	u32_t cpu = current->cpu;
+
+	load_cpu_segments (cpu);
+	load_idt();
+
+	init_pat();
+	init_apic_secondary();
+
+	wmb();
+	cpu_data[cpu].online = 1;
+
+	cpu_idle();
+}
+
+
+/* Called from _reschedule_hdl in irq.S. need_resched is already set,
+ * irq_exit acts on it. */
+
+void smp_reschedule_interrupt (void)
+{
+	apic_eoi();
+}
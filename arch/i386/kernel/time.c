@@ -0,0 +1,271 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     arch/i386/kernel/time.c
+ * Description:   The timer tick and the clocksource: i8253 PIT
+ *                programming and TSC calibration.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* The tick comes from the local APIC timer if there is one and from
+ * channel 0 of the PIT otherwise. Either way timer_tick runs HZ times
+ * a second, unless the idle loop has stopped the tick.
+ *
+ * Time itself is read from the time stamp counter. We calibrate it
+ * once against the PIT at boot and derive a mult/shift pair so that
+ * converting cycles to nanoseconds is two multiplies and a shift. No
+ * division and no locks, so ktime_get is cheap enough to call from
+ * anywhere.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/time.h>
+#include <nodes/timer.h>
+#include <nodes/sched.h>
+#include <asm/interrupt.h>
+#include <asm/timer.h>
+#include <asm/apic.h>
+#include <asm/msr.h>
+#include <asm/div64.h>
+#include <asm/io.h>
+#include <io.h>
+#include <nodes/log.h>
+#include <nodes/profile.h>
+
+
+#define LATCH ((PIT_HZ + HZ / 2) / HZ)  /* PIT clocks per tick */
+
+#define CALIBRATE_LATCH (PIT_HZ / 100)  /* 10 ms worth of PIT clocks */
+
+#define TSC_SHIFT 22   /* Fixed point shift of tsc_mult */
+
+
+volatile u32_t jiffies;
+
+u32_t tsc_khz;
+u64_t tsc_base;
+u32_t tsc_mult;
+u32_t tsc_shift;
+
+struct clock_event *tick_device;
+
+static ktime_t last_jiffies_update;  /* ktime of the tick that jiffies
+				      * was last advanced for */
+
+
+/* Program PIT channel 0 as a rate generator (mode 2) */
+
+void pit_set_periodic (u32_t latch)
+{
+	outb (0x34, PIT_MODE);
+	outb (latch & 0xff, PIT_CH0);
+	outb (latch >> 8, PIT_CH0);
+}
+
+
+static void pit_tick_periodic (void)
+{
+	pit_set_periodic (LATCH);
+}
+
+
+/* Channel 0 in mode 0 (interrupt on terminal count) fires once */
+
+static void pit_set_next_event (u64_t delta_ns)
+{
+	u64_t count = delta_ns * PIT_HZ;
+
+	do_div (&count, NSEC_PER_SEC);
+	if (count == 0) count = 1;
+
+	outb (0x30, PIT_MODE);
+	outb (count & 0xff, PIT_CH0);
+	outb ((count >> 8) & 0xff, PIT_CH0);
+}
+
+
+static struct clock_event pit_clock_event = {
+	"PIT", (u64_t) 0xffff * NSEC_PER_SEC / PIT_HZ,
+	pit_tick_periodic, pit_set_next_event
+};
+
+
+/* Run channel 2 in mode 0 (interrupt on terminal count) with the
+ * speaker disconnected and spin until its output goes high. */
+
+void pit_wait (u32_t latch)
+{
+	outb ( (inb (PIT_PORT_B) & ~0x02) | 0x01, PIT_PORT_B);
+
+	outb (0xb0, PIT_MODE);
+	outb (latch & 0xff, PIT_CH2);
+	outb (latch >> 8, PIT_CH2);
+
+	while ( (inb (PIT_PORT_B) & 0x20) == 0)
+		;
+}
+
+
+/* Measure the TSC frequency against 10 ms of PIT time. */
+
+static void calibrate_tsc (void)
+{
+	u64_t t1, t2, khz;
+	u64_t mult;
+
+	if ( !(cpu_features() & CPUID_TSC)) return;
+
+	t1 = rdtsc();
+	pit_wait (CALIBRATE_LATCH);
+	t2 = rdtsc();
+
+	/* cycles * PIT_HZ / (latch * 1000) */
+	khz = (t2 - t1) * PIT_HZ;
+	do_div (&khz, CALIBRATE_LATCH);
+	do_div (&khz, 1000);
+
+	if (khz == 0) return;
+
+	/* ns per cycle is 10^6 / khz, in fixed point */
+	mult = (u64_t) NSEC_PER_MSEC << TSC_SHIFT;
+	do_div (&mult, (u32_t) khz);
+
+	tsc_mult = (u32_t) mult;
+	tsc_shift = TSC_SHIFT;
+	tsc_base = rdtsc();
+	tsc_khz = (u32_t) khz;
+}
+
+
+void udelay (u32_t usecs)
+{
+	u64_t end;
+
+	if (!tsc_khz){
+		/* Each inb is paced by the outb to port 0x80, which is
+		 * about a microsecond on the ISA bus */
+		while (usecs--) inb (PIT_PORT_B);
+		return;
+	}
+
+	end = (u64_t) usecs * tsc_khz;
+	do_div (&end, 1000);
+	end += rdtsc();
+
+	while (rdtsc() < end)
+		;
+}
+
+
+/* Advance jiffies by the number of whole ticks that have passed since
+ * it was last advanced. While the tick is stopped in idle, a single
+ * interrupt may stand for many ticks. Without a TSC we can not tell
+ * and just count interrupts.
+ */
+
+void update_jiffies (void)
+{
+	u64_t delta;
+	u32_t ticks;
+
+	if (!tsc_khz){
+		jiffies++;
+		return;
+	}
+
+	delta = ktime_get() - last_jiffies_update;
+	if (delta < TICK_NSEC) return;
+
+	do_div (&delta, TICK_NSEC);
+	ticks = (u32_t) delta;
+
+	jiffies += ticks;
+	last_jiffies_update += (u64_t) ticks * TICK_NSEC;
+}
+
+
+/* Called on every tick interrupt with interrupts disabled, on every
+ * processor. Time keeping and the timer wheel belong to processor 0. */
+
+void timer_tick (void)
+{
+	if (smp_processor_id() == 0){
+		update_jiffies();
+		run_local_timers();
+	}
+
+	scheduler_tick();
+
+	profile_tick();
+}
+
+
+/* The irq 0 handler, used when the tick comes from the PIT */
+
+static int pit_interrupt (u32_t irq, void *dev)
+{
+	timer_tick();
+	return IRQ_HANDLED;
+}
+
+static struct irq_action pit_action = {
+	pit_interrupt, 0, 0, "timer"
+};
+
+
+/* Calibrate the TSC and start the tick. Called with interrupts
+ * enabled, after init_interrupts. */
+
+void init_time (void)
+{
+	calibrate_tsc();
+
+	if (tsc_khz)
+		printk (LOG_INFO, "TSC running at %u.%03u MHz\n", tsc_khz / 1000,
+			tsc_khz % 1000);
+	else
+		printk (LOG_INFO, "No usable TSC, ktime has tick resolution\n");
+
+	last_jiffies_update = ktime_get();
+
+#ifdef CONFIG_LOCAL_APIC
+	if (init_apic())
+		tick_device = apic_timer_setup();
+#endif /* CONFIG_LOCAL_APIC */
+
+	if (!tick_device){
+		tick_device = &pit_clock_event;
+		tick_device->set_periodic();
+		request_irq (TIMER_IRQ, &pit_action);
+	}
+
+	printk (LOG_INFO, "Timer tick from the %s at %d Hz\n", tick_device->name, HZ);
+}
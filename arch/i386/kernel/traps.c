@@ -0,0 +1,131 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     arch/i386/kernel/traps.c
+ * Description:   CPU exception handling for the IA-32.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#include <sys/types.h>
+#include <asm/interrupt.h>
+#include <asm/traps.h>
+#include <asm/mm.h>
+#include <io.h>
+#include <nodes/log.h>
+
+
+/* The table of stub addresses in traps_entry.S */
+extern int_handler_t trap_stubs[NUM_OF_TRAPS];
+
+
+/* The dispatch table used by trap_common in traps_entry.S */
+trap_handler_t trap_table[NUM_OF_TRAPS];
+
+
+static const char *trap_names[NUM_OF_TRAPS] = {
+	"Divide error", "Debug", "NMI", "Breakpoint", "Overflow",
+	"BOUND range exceeded", "Invalid opcode", "Device not available",
+	"Double fault", "Coprocessor segment overrun", "Invalid TSS",
+	"Segment not present", "Stack fault", "General protection",
+	"Page fault", "Reserved", "x87 FPU error", "Alignment check",
+	"Machine check", "SIMD floating point", "Virtualization",
+	"Control protection", "Reserved", "Reserved", "Reserved",
+	"Reserved", "Reserved", "Reserved", "Reserved", "Reserved",
+	"Security", "Reserved"
+};
+
+
+/* Dump the machine state in `frame' and halt. This is what every
+ * exception that nobody has claimed ends up in. Note that we do not
+ * touch the PIC here. Exceptions are not interrupts and must never be
+ * acknowledged as such.
+ */
+
+void unhandled_trap (struct trap_frame *frame)
+{
+	log_panic();
+
+	printk (LOG_EMERG, "Unhandled exception %d (%s), error code 0x%x\n",
+		frame->vector, trap_names[frame->vector], frame->error);
+
+	if (frame->vector == TRAP_PF)
+		printk (LOG_EMERG, "Faulting address : 0x%x\n", read_cr2());
+
+	printk (LOG_EMERG, "eip: 0x%x  cs: 0x%x  eflags: 0x%x\n",
+		frame->eip, frame->cs, frame->eflags);
+	printk (LOG_EMERG, "eax: 0x%x  ebx: 0x%x  ecx: 0x%x  edx: 0x%x\n",
+		frame->eax, frame->ebx, frame->ecx, frame->edx);
+	printk (LOG_EMERG, "esi: 0x%x  edi: 0x%x  ebp: 0x%x  esp: 0x%x\n",
+		frame->esi, frame->edi, frame->ebp, frame->esp);
+
+	printk (LOG_EMERG, "System halted.\n");
+
+	for (;;)
+		__asm__ __volatile__ ("cli\n\thlt");
+}
+
+
+/* Claim the exception `vector' for `handler' and return the previous
+ * handler. A single aligned store, so it is safe to call with
+ * interrupts enabled.
+ */
+
+trap_handler_t set_trap_handler (u32_t vector, trap_handler_t handler)
+{
+	trap_handler_t old;
+
+	if (vector >= NUM_OF_TRAPS){
+		printk (LOG_ERR, "ERROR: Invalid exception vector : %d\n", vector);
+		return 0;
+	}
+
+	if (!handler) handler = unhandled_trap;
+
+	old = trap_table[vector];
+	trap_table[vector] = handler;
+
+	return old;
+}
+
+
+/* Points the first 32 vectors of the IDT at the stubs in traps_entry.S.
+ * This runs from init_idt in boot.S, right after fill_idt has put the
+ * stand in handler everywhere.
+ */
+
+void init_traps (void)
+{
+	u32_t i;
+
+	for (i = 0; i < NUM_OF_TRAPS; i++){
+		trap_table[i] = unhandled_trap;
+		set_intr_gate (i, trap_stubs[i]);
+	}
+}
@@ -37,8 +37,12 @@
 #include <mm/mm.h>
 #include <sys/types.h>
 #include <asm/mm.h>
+#include <asm/msr.h>
 #include <io.h>
+#include <nodes/log.h>
 #include <multiboot.h>
+#include <elf.h>
+#include <nodes/boot_phase.h>
 
 
 extern u32_t kernel_pg_dir[];  /* The page tables and page directories
@@ -50,6 +54,14 @@ multiboot_info_t *_mbi;  /* A global pointer to the multiboot
 			  * information structure */
 
 
+#define IO_PG_TABLES 8   /* Number of page tables we keep for mapping
+			  * device memory */
+
+static u32_t io_pg_tables[IO_PG_TABLES][1024] __attribute__ ((aligned (4096)));
+
+static u32_t next_io_pg_table;  /* The next unused one of the above */
+
+
 /* =============== pg_dir_index =============== */
 /* Returns the page directory index of the passed address */
 
@@ -75,23 +87,6 @@ static inline u32_t page_offset ( u32_t virt_addr )
 }
 
 
-/* =============== virt_to_phys =============== */
-/* NOTE <14/2/2004> <apurva@gmx.net> : This function needs updating.
- * Returns the physical address corresponding to the passed virtual
- * address. The calculation is done according to the current page
- * table
- */
-
-static inline u32_t virt_to_phys (u32_t virt_addr, u32_t *pg_dir)
-{
-	u32_t *pg_table = (u32_t *) pg_dir [pg_dir_index (virt_addr)];
-	u32_t page = pg_table [ pg_table_index ( virt_addr) ];
-	
-	return (page + page_offset ( virt_addr));
-
-}
-
-
 /* =============== insert_pg_dir_entry =============== */
 /* For the passed virtual address `virt_addr', this function will
  * insert the page table address `pg_table_addr' into the page
@@ -133,7 +128,8 @@ static inline void insert_pg_table_entry ( u32_t virt_page,
  *
  * The function does the following in order:
  * 1) It identity maps the video memory.
- * 2) It identity maps the kernel onto itself.
+ * 2) It identity maps the kernel onto itself, and the rest of the
+ * lower memory zone after it.
  * 3) It creates mappings from virtual address space of the kernel to
  * its corresponding physical addresses.
  * 4) It identity maps the page directory onto itself. This is needed
@@ -178,6 +174,26 @@ void init_paging (u32_t upper_mem_kb, u32_t img_phys_end_addr)
 		tmp1 += PAGE_SIZE_BYTES;
 	}
 
+	/* Identity map the rest of the lower memory zone so that pages
+	 * from LOW_MEM_ZONE can be used without mapping them first.
+	 * The page tables for 4-16 MB follow pg_table2 in boot.S. */
+	for ( tmp2 = 1; tmp2 < pg_dir_index (LOW_MEM_BOUNDARY); tmp2++){
+		insert_pg_dir_entry ( tmp2 << 22,
+				      (u32_t *) phys_addr ( (u32_t) kernel_pg_dir), 
+				      phys_addr ( (u32_t) pg_table2) + tmp2 * PAGE_SIZE_BYTES,
+				      PRESENT | RW | ACCESSED);
+	}
+
+	while ( tmp1 < LOW_MEM_BOUNDARY){
+		insert_pg_table_entry ( tmp1, 
+					(u32_t *) (phys_addr ( (u32_t) pg_table2) + 
+						   pg_dir_index (tmp1) * PAGE_SIZE_BYTES),
+					tmp1, 
+					PRESENT | RW | ACCESSED);
+
+		tmp1 += PAGE_SIZE_BYTES;
+	}
+
 
 	/* Set the page directory entry for the 4 MB starting at
 	 * virtual address 0xC0000000 */
@@ -216,6 +232,139 @@ void init_paging (u32_t upper_mem_kb, u32_t img_phys_end_addr)
 }
 
 
+/* =============== virt_to_phys =============== */
+/* Returns the physical address the passed virtual address maps to in
+ * the current page directory, or 0 if it is not mapped. Page 0 is
+ * never mapped, so 0 is not a valid answer. The page directory and
+ * page tables are reached through their physical addresses, so they
+ * must be in the identity mapped lower memory zone.
+ */
+
+u32_t virt_to_phys (u32_t virt_addr)
+{
+	u32_t *pg_dir = get_curr_pg_dir();
+	u32_t *pg_table;
+	u32_t pde, pte;
+
+	pde = pg_dir [pg_dir_index (virt_addr)];
+	if ( !(pde & PRESENT)) return 0;
+
+	if (pde & FOUR_MB_PAGE)
+		return (pde & 0xffc00000) + (virt_addr & 0x3fffff);
+
+	pg_table = (u32_t *) (pde & ~0xfff);
+	pte = pg_table [pg_table_index (virt_addr)];
+	if ( !(pte & PRESENT)) return 0;
+
+	return (pte & ~0xfff) + page_offset (virt_addr);
+}
+
+
+/* =============== ioremap =============== */
+/* Identity maps the device memory at `phys' into the kernel page
+ * directory. Device memory lives high up in the physical address space
+ * (the local APIC at 0xFEE00000, framebuffers, ...) where it can not
+ * collide with the kernel at PAGE_OFFSET. The page tables come from a
+ * small static pool. Since the kernel image is identity mapped, the
+ * tables can be reached through their physical addresses.
+ */
+
+void *ioremap (u32_t phys, u32_t size, u32_t flags)
+{
+	u32_t addr = phys & ~(PAGE_SIZE_BYTES - 1);
+	u32_t end = align_to_boundary (phys + size, PAGE_SIZE_BYTES);
+	u32_t *pg_table;
+
+	if ( pg_dir_index (addr) == pg_dir_index (PAGE_OFFSET) || 
+	     pg_dir_index (end - 1) == 1023){
+		printk (LOG_ERR, "ioremap: can not map 0x%x\n", phys);
+		return 0;
+	}
+
+	for (; addr < end; addr += PAGE_SIZE_BYTES){
+
+		if ( !(kernel_pg_dir [pg_dir_index (addr)] & PRESENT)){
+
+			if (next_io_pg_table == IO_PG_TABLES){
+				printk (LOG_ERR, "ioremap: out of page tables\n");
+				return 0;
+			}
+
+			pg_table = io_pg_tables [next_io_pg_table++];
+			insert_pg_dir_entry ( addr, kernel_pg_dir,
+					      phys_addr ( (u32_t) pg_table),
+					      PRESENT | RW | ACCESSED);
+		}
+
+		pg_table = (u32_t *) (kernel_pg_dir [pg_dir_index (addr)] & ~0xfff);
+
+		insert_pg_table_entry ( addr, pg_table, addr,
+					PRESENT | RW | ACCESSED | flags);
+		invlpg (addr);
+	}
+
+	return (void *) phys;
+}
+
+
+/* =============== init_pat =============== */
+/* The PAT entry a page uses is picked by its PWT, PCD and PAT bits.
+ * Out of reset entry 1, for PWT alone, is write through. We make it
+ * write combining, so stores to a framebuffer are gathered into
+ * whole bursts instead of going out one at a time. Nothing else asks
+ * for write through.
+ */
+
+#define PAT_WC     0x01ULL
+#define PAT_ENTRY(n, type)  ( (type) << ( (n) * 8))
+
+void init_pat (void)
+{
+	u64_t pat;
+
+	if ( !(cpu_features() & CPUID_PAT)) return;
+
+	pat = rdmsr (MSR_IA32_PAT);
+	pat &= ~PAT_ENTRY (1, 0xffULL);
+	pat |= PAT_ENTRY (1, PAT_WC);
+	wrmsr (MSR_IA32_PAT, pat);
+}
+
+
+/* =============== elf_sections_end =============== */
+/* The boot loader puts the sections of the kernel that are not part
+ * of its image, the symbol and string tables, right behind it, where
+ * the page allocator would start. Returns the page aligned physical
+ * end of those sections and of the table of their headers, or
+ * `img_end' if that is further. Only the lower memory zone is looked
+ * at, since it is what the kernel can reach. Runs before paging, so
+ * `mbi' is a physical address.
+ */
+
+static u32_t elf_sections_end (multiboot_info_t *mbi, u32_t img_end)
+{
+	elf32_shdr_t *sh;
+	u32_t end = img_end, i, e;
+
+	if ( !is_bit_set (mbi->flags, MULTIBOOT_INFO_ELF_SHDR)) return img_end;
+
+	e = mbi->u.elf_sec.addr + mbi->u.elf_sec.num * mbi->u.elf_sec.size;
+	if (e > end && e <= LOW_MEM_BOUNDARY) end = e;
+
+	for (i = 0; i < mbi->u.elf_sec.num; i++){
+		sh = (elf32_shdr_t *) (mbi->u.elf_sec.addr + i * mbi->u.elf_sec.size);
+
+		/* The sections of the image have their virtual addresses */
+		if ( !sh->sh_addr || sh->sh_addr >= PAGE_OFFSET) continue;
+
+		e = sh->sh_addr + sh->sh_size;
+		if (e > end && e <= LOW_MEM_BOUNDARY) end = e;
+	}
+
+	return align_to_boundary (end, PAGE_SIZE_BYTES);
+}
+
+
 /* =============== init_mm =============== */
 /* Initialize the virtual memory system. Basically this function gets
  * the total installed physical memory from the bootloader and then
@@ -228,12 +377,22 @@ void init_mm (u32_t magic, u32_t addr)
 	multiboot_info_t *mbi = (multiboot_info_t *) addr;
 
 	u32_t up_mem_kb = 0;
+	u32_t img_end;
+
+	boot_phase ("init_paging");
+
+	/* Keep the symbol table, for the profiler */
+	img_end = elf_sections_end (mbi, phys_addr ( (u32_t) __kernel_img_end));
 	
 	if ( is_bit_set (mbi->flags, 0) ) up_mem_kb = mbi->mem_upper;
 
-	init_paging (up_mem_kb, phys_addr ( (u32_t) __kernel_img_end) );
+	init_paging (up_mem_kb, img_end);
+
+	init_pat();
 
 	_mbi = mbi;
 
-	init_page_alloc (up_mem_kb, phys_addr ( (u32_t) __kernel_img_end));
+	boot_phase ("init_page_alloc");
+
+	init_page_alloc (up_mem_kb, img_end);
 }
@@ -0,0 +1,115 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/asm-i386/apic.h
+ * Description:   Local APIC registers and routines.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __APIC_H__
+#define __APIC_H__
+
+#include <sys/types.h>
+
+/* Register offsets from the local APIC base */
+#define APIC_ID          0x020
+#define APIC_VERSION     0x030
+#define APIC_TPR         0x080
+#define APIC_EOI         0x0B0
+#define APIC_SPURIOUS    0x0F0
+#define APIC_ICR_LOW     0x300
+#define APIC_ICR_HIGH    0x310
+#define APIC_LVT_TIMER   0x320
+#define APIC_TIMER_INIT  0x380
+#define APIC_TIMER_CURR  0x390
+#define APIC_TIMER_DIV   0x3E0
+
+#define APIC_SW_ENABLE   (1 << 8)   /* In APIC_SPURIOUS */
+#define APIC_LVT_MASKED  (1 << 16)
+#define APIC_TIMER_PERIODIC (1 << 17)
+#define APIC_TIMER_DIV16 0x3
+
+/* In APIC_ICR_LOW */
+#define APIC_DM_FIXED    0x000
+#define APIC_DM_INIT     0x500
+#define APIC_DM_STARTUP  0x600
+#define APIC_ICR_BUSY    (1 << 12)
+#define APIC_LEVEL_ASSERT (1 << 14)
+
+/* The vectors we use for local APIC interrupts */
+#define LOCAL_TIMER_VECTOR  0xEF
+#define RESCHEDULE_VECTOR   0xFD
+#define SPURIOUS_VECTOR     0xFF
+
+
+extern volatile u32_t *lapic;  /* The mapped local APIC, or null if
+				* there is none */
+
+static inline u32_t apic_read (u32_t reg)
+{
+	return lapic[reg >> 2];
+}
+
+static inline void apic_write (u32_t reg, u32_t val)
+{
+	lapic[reg >> 2] = val;
+}
+
+/* Signal the end of an interrupt to the local APIC */
+static inline void apic_eoi (void)
+{
+	apic_write (APIC_EOI, 0);
+}
+
+
+/* Returns the id of the local APIC of this processor */
+static inline u32_t apic_id (void)
+{
+	return apic_read (APIC_ID) >> 24;
+}
+
+/* Send the interrupt described by `icr' to the processor with local
+ * APIC id `dest' and wait for it to be accepted. Interrupts must be
+ * disabled, the two register writes belong together. */
+void apic_send_ipi (u32_t dest, u32_t icr);
+
+
+/* Detect, map and enable the local APIC. Returns 0 if there is none. */
+int init_apic (void);
+
+/* Enable the local APIC of an application processor and start its
+ * timer with the calibration done on the boot processor. */
+void init_apic_secondary (void);
+
+/* Calibrate the local APIC timer against the PIT and start it in
+ * periodic mode at HZ. Returns its clock_event. */
+struct clock_event *apic_timer_setup (void);
+
+#endif /* __APIC_H__ */
@@ -0,0 +1,104 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/asm-i386/atomic.h
+ * Description:   Atomic operations and memory barriers.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __ATOMIC_H__
+#define __ATOMIC_H__
+
+#include <sys/types.h>
+
+
+/* Stop the compiler from moving memory accesses across this point */
+#define barrier()  __asm__ __volatile__ ("" ::: "memory")
+
+/* x86 only lets a load pass an earlier store to another address, so
+ * only the full barrier needs an instruction. */
+#define mb()   __asm__ __volatile__ ("mfence" ::: "memory")
+#define rmb()  barrier()
+#define wmb()  barrier()
+
+/* A load that later accesses can not move before, and a store that
+ * earlier accesses can not move after. The processor already keeps
+ * that order, so they only have to hold back the compiler. */
+#define load_acquire(p) ({						\
+	__typeof__ (*(p)) __v = *(p);					\
+	barrier();							\
+	__v;								\
+})
+
+#define store_release(p, v) do {					\
+	barrier();							\
+	*(p) = (v);							\
+} while (0)
+
+/* Tell the processor we are spinning. Saves power and frees the
+ * pipeline for the other hyperthread. */
+#define cpu_relax()  __asm__ __volatile__ ("pause" ::: "memory")
+
+
+/* Store `val' in `*ptr' and return the old value. xchg with memory is
+ * always locked. */
+static inline u32_t xchg (volatile u32_t *ptr, u32_t val)
+{
+	__asm__ __volatile__ ("xchgl %0, %1"
+			      : "=r" (val), "+m" (*ptr)
+			      : "0" (val)
+			      : "memory");
+	return val;
+}
+
+/* If `*ptr' is `old' store `new' in it. Returns the value `*ptr' had,
+ * which is `old' if the exchange happened. */
+static inline u32_t cmpxchg (volatile u32_t *ptr, u32_t old, u32_t new)
+{
+	u32_t prev;
+
+	__asm__ __volatile__ ("lock; cmpxchgl %2, %1"
+			      : "=a" (prev), "+m" (*ptr)
+			      : "r" (new), "0" (old)
+			      : "memory");
+	return prev;
+}
+
+/* Add `val' to `*ptr' and return the old value */
+static inline u32_t xadd (volatile u32_t *ptr, u32_t val)
+{
+	__asm__ __volatile__ ("lock; xaddl %0, %1"
+			      : "=r" (val), "+m" (*ptr)
+			      : "0" (val)
+			      : "memory");
+	return val;
+}
+
+#endif /* __ATOMIC_H__ */
@@ -0,0 +1,84 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/asm-i386/div64.h
+ * Description:   64 bit arithmetic helpers that do not need libgcc.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __DIV64_H__
+#define __DIV64_H__
+
+#include <sys/types.h>
+
+/* We do not link against libgcc, so a plain 64 bit `/' or `%' does
+ * not link. Everything that has to divide a 64 bit value goes through
+ * here instead.
+ */
+
+
+/* Divide `*n' by `base' in place and return the remainder. Two divl
+ * instructions, the first on the upper half so the second can not
+ * overflow. */
+
+static inline u32_t do_div (u64_t *n, u32_t base)
+{
+	u32_t high = (u32_t) (*n >> 32);
+	u32_t low = (u32_t) *n;
+	u32_t qhigh = high / base;
+	u32_t rem = high % base;
+	u32_t qlow;
+
+	__asm__ ("divl %4"
+		 : "=a" (qlow), "=d" (rem)
+		 : "0" (low), "1" (rem), "rm" (base));
+
+	*n = ((u64_t) qhigh << 32) | qlow;
+
+	return rem;
+}
+
+
+/* Returns (a * mul) >> shift without losing the upper bits of the 96
+ * bit product. `shift' must be less than 32. */
+
+static inline u64_t mul_u64_u32_shr (u64_t a, u32_t mul, u32_t shift)
+{
+	u32_t ah = (u32_t) (a >> 32);
+	u64_t ret;
+
+	ret = ((u64_t) (u32_t) a * mul) >> shift;
+
+	if (ah) ret += ((u64_t) ah * mul) << (32 - shift);
+
+	return ret;
+}
+
+#endif /* __DIV64_H__ */
@@ -81,6 +81,12 @@ typedef struct {
 } gdt_desc_t;
 
 
+#define GDT_ENTRIES 4   /* Null, data, code and per processor data */
+
+#define GDT_PERCPU  3   /* The per processor data segment, see
+			 * asm/percpu.h. Not in the boot GDT. */
+#define PERCPU_SEL  (GDT_PERCPU * 8)
+
 extern gdt_desc_t __gdt[];
 
 
@@ -109,6 +115,21 @@ static inline void set_seg_desc ( u32_t *gate_addr, u8_t dpl, u8_t type,
 }
 
 
+/* Load `gdt', which has `entries' descriptors, into the GDT register.
+ * The segment registers keep what they have cached, so the new table
+ * must have the same layout. */
+
+static inline void load_gdt (gdt_desc_t *gdt, u32_t entries)
+{
+	struct {
+		u16_t limit;
+		u32_t base;
+	} __attribute__ ((packed)) ptr = { entries * 8 - 1, (u32_t) gdt };
+
+	__asm__ __volatile__ ("lgdt %0" :: "m" (ptr));
+}
+
+
 void init_gdt (void);
 
 #endif /* __GDT_H__ */
@@ -39,10 +39,6 @@
 
 #include <sys/types.h>
 
-#define MAX_SHARED_INTERRUPTS 10 /* Max number of devices sharing an
-				  * irq line 
-				  */
-
 #define NUM_OF_IRQS 16           /* Number of IRQ lines 
 				  */
 
@@ -66,11 +62,60 @@
 #define sti()	__asm__ __volatile__ ("sti");
 
 
-/* The type that represents our ISR's */
+/* Enable interrupts and halt until the next one. The sti only takes
+ * effect after the hlt, so an interrupt can not slip in between and
+ * leave us halted with work to do. */
+
+#define safe_halt()	__asm__ __volatile__ ("sti\n\thlt" ::: "memory")
+
+
+/* Save the interrupt flag into `flags' and disable interrupts */
+
+#define local_irq_save(flags)	__asm__ __volatile__ ("pushfl\n\t"	\
+						      "popl %0\n\t"	\
+						      "cli"		\
+						      : "=g" (flags)	\
+						      :: "memory")
+
+/* The interrupt flag in EFLAGS */
+
+#define EFLAGS_IF  0x200
+
+/* Save the interrupt flag into `flags' and leave it as it is */
+
+#define local_save_flags(flags)	__asm__ __volatile__ ("pushfl\n\t"	\
+						      "popl %0"		\
+						      : "=g" (flags)	\
+						      :: "memory")
+
+#define irqs_disabled_flags(flags)  (!( (flags) & EFLAGS_IF))
+
+/* Restore the interrupt flag saved by local_irq_save */
+
+#define local_irq_restore(flags) __asm__ __volatile__ ("pushl %0\n\t"	\
+							"popfl"		\
+							:: "g" (flags)	\
+							: "memory", "cc")
+
+
+/* The type of the entry points that are stored in the IDT */
 
 typedef void (*int_handler_t) (void); 
 
 
+/* Return values of an irq handler */
+
+#define IRQ_NONE        0  /* The interrupt was not from our device */
+#define IRQ_HANDLED     1  /* The interrupt was ours and is done with */
+#define IRQ_WAKE_THREAD 2  /* The interrupt was ours, run thread_fn */
+
+
+/* The type that represents our ISR's. `dev' is the cookie that was
+ * passed in the irq_action at registration time. */
+
+typedef int (*irq_handler_t) (u32_t irq, void *dev);
+
+
 /* Initialize the interrupt controller. In this case it is IC8259 */
 
 void init_int_controller(void);
@@ -91,22 +136,81 @@ typedef struct _int_desc{
 extern _int_desc __idt;
 
 
+/* One of these exists for every device on an irq line. The storage
+ * belongs to the driver (usually a static in the driver), so lines
+ * can be shared by any number of devices without a fixed table.
+ *
+ * If `thread_fn' is set the handler is threaded. request_irq creates
+ * a kernel thread for it. `handler' then only has to quiet the device
+ * and return IRQ_WAKE_THREAD. The line is masked and the thread is
+ * woken to run `thread_fn' with interrupts enabled, after which the
+ * line is unmasked again. `handler' may be null for a threaded
+ * handler, in which case every interrupt wakes the thread.
+ */
+
+struct task;
+
+struct irq_action {
+	irq_handler_t handler;     /* The hard handler */
+	irq_handler_t thread_fn;   /* The threaded handler, or null */
+	void *dev;                 /* Passed to both handlers */
+	const char *name;          /* The name of the device */
+
+	u32_t irq;                 /* The line we are on */
+	u32_t thread_pending;      /* Set when thread_fn has to run */
+	u32_t thread_stop;         /* Tells the thread to exit */
+	struct task *thread;       /* The thread running thread_fn */
+	struct irq_action *next;   /* The next device on this line */
+};
+
+
+/* What the stubs in irq.S leave on the stack: the registers saved by
+ * pusha and the return frame the CPU pushed. The fields are in the
+ * reverse order of the pushes. */
+
+struct irq_frame {
+	u32_t edi, esi, ebp, esp;       /* Pushed by pusha */
+	u32_t ebx, edx, ecx, eax;
+	u32_t eip, cs, eflags;          /* Pushed by the CPU */
+};
+
+
 /* The irq type. Each irq line has one object of this type. */
 
 typedef struct irq_t{
-	u32_t num_of_isrs; /* Number of registered ISR's for this
-				    irq */
+	struct irq_action *action; /* The chain of devices on this
+				    * line */
+
+	u32_t num;       /* The irq number */
+	u32_t masked;    /* Number of threaded handlers that are
+			  * keeping the line masked */
 
-	u32_t num; /* The irq number */
-	int_handler_t isr[MAX_SHARED_INTERRUPTS]; /* Pointers to the
-						     * ISRS  */
-						    
+	u32_t unhandled; /* Number of interrupts nobody claimed */
 } irq_t;
 
 
 
-/* Set a handler for a particular irq number */
-void set_irq_handler (u32_t irq_num,  int_handler_t handler);
+/* Store `handler' into the IDT as an interrupt gate for `vector' */
+void set_intr_gate (u16_t vector, int_handler_t handler);
+
+/* Add `action' to the chain of handlers of irq `irq_num'. The line is
+ * enabled when its first handler is added. Returns 0 on success and
+ * -1 on error. */
+int request_irq (u32_t irq_num, struct irq_action *action);
+
+/* Remove the handler registered with cookie `dev' from irq
+ * `irq_num'. The line is disabled when its last handler goes. A
+ * threaded handler has exited its thread by the time this returns. */
+void free_irq (u32_t irq_num, void *dev);
+
+/* The frame of the interrupt this processor is in the handlers of, or
+ * null. set_irq_frame returns the one it replaces, for nesting. */
+struct irq_frame *get_irq_frame (void);
+struct irq_frame *set_irq_frame (struct irq_frame *frame);
+
+/* Returns the number of interrupts seen on line `irq_num' by all the
+ * processors */
+u32_t irq_count (u32_t irq_num);
 
 /* Enable irq line */
 void enable_irq (u32_t irq);
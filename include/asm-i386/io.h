@@ -55,4 +55,34 @@ static inline u8_t inb(u16_t port)
 }
 
 
+/* The word and double word ports belong to newer devices, which need
+ * no delay after an access */
+
+static inline void outw (u16_t data, u16_t port)
+{
+	__asm__ __volatile__ ("outw %%ax, %%dx" :: "a" (data), "d" (port));
+}
+
+static inline u16_t inw (u16_t port)
+{
+	u16_t _v;
+
+	__asm__ __volatile__ ("inw %%dx, %%ax" : "=a" (_v) : "d" (port));
+	return _v;
+}
+
+static inline void outl (u32_t data, u16_t port)
+{
+	__asm__ __volatile__ ("outl %%eax, %%dx" :: "a" (data), "d" (port));
+}
+
+static inline u32_t inl (u16_t port)
+{
+	u32_t _v;
+
+	__asm__ __volatile__ ("inl %%dx, %%eax" : "=a" (_v) : "d" (port));
+	return _v;
+}
+
+
 #endif /* __ASMIO_H__ */
@@ -47,8 +47,35 @@
 #define ACCESSED           ( (u32_t) 1 << 5)
 #define GLOBAL             ( (u32_t) 1 << 8) 
 
+/* init_pat makes PWT pages write combining, where there is a PAT.
+ * Without one they are write through. */
+#define PAGE_WRITE_COMBINE PAGE_WRITE_THROUGH
+
 /* #define DIRTY              ( (u32_t) 1 << 6) */
-/* #define FOUR_MB_PAGE       ( (u32_t) 1 << 7) */
+#define FOUR_MB_PAGE       ( (u32_t) 1 << 7)  /* In a PDE */
+
+
+/* Map the `size' bytes of device memory at physical address `phys'
+ * onto the same virtual addresses, with the PTE flags `flags' added
+ * to PRESENT | RW. Returns the virtual address or null if we ran out
+ * of page tables. Defined in arch/i386/mm/init.c. */
+void *ioremap (u32_t phys, u32_t size, u32_t flags);
+
+/* Set up the page attribute table of this processor. Every processor
+ * has to, as they must all agree on it. */
+void init_pat (void);
+
+
+/* The physical address `virt_addr' maps to in the current page
+ * directory, or 0 if it is not mapped */
+u32_t virt_to_phys (u32_t virt_addr);
+
+
+/* Invalidate the TLB entry of the page containing `addr' */
+static inline void invlpg (u32_t addr)
+{
+	asm volatile ("invlpg (%0)" :: "r" (addr) : "memory");
+}
 
 
 /* Returns the phyiscal address of the current page directory. */
@@ -73,6 +100,30 @@ static inline void set_pg_dir(u32_t pg_dir)
 		      :: "r" (pg_dir) : "%eax" );
 }
 
+/* Returns the linear address that caused the last page fault. */
+static inline u32_t read_cr2()
+{
+	u32_t addr;
+
+	asm volatile ("movl %%cr2, %0"
+		      : "=r" (addr) );
+
+	return addr;
+}
+
+#define CR0_PG  0x80000000   /* The bit of cr0 that turns paging on */
+
+/* Returns the cr0 register */
+static inline u32_t read_cr0()
+{
+	u32_t cr0;
+
+	asm volatile ("movl %%cr0, %0"
+		      : "=r" (cr0) );
+
+	return cr0;
+}
+
 /* Sets bit 31 on the cr0 register to enable paging */
 #define enable_paging() asm volatile ("movl %%cr0, %%eax\n\t"		\
 				      "orl $0x80000000, %%eax\n\t"	\
@@ -0,0 +1,97 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/asm-i386/msr.h
+ * Description:   Time stamp counter, model specific register and
+ *                cpuid access for the i386
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __MSR_H__
+#define __MSR_H__
+
+#include <sys/types.h>
+
+#define MSR_IA32_APIC_BASE  0x1B   /* Local APIC base address */
+#define MSR_IA32_PAT        0x277  /* Page attribute table */
+
+/* Feature flags in edx of cpuid leaf 1 */
+#define CPUID_TSC    (1 << 4)
+#define CPUID_MSR    (1 << 5)
+#define CPUID_APIC   (1 << 9)
+#define CPUID_PAT    (1 << 16)
+
+
+/* Read the time stamp counter */
+static inline u64_t rdtsc (void)
+{
+	u64_t tsc;
+
+	__asm__ __volatile__ ("rdtsc" : "=A" (tsc));
+
+	return tsc;
+}
+
+/* Read the model specific register `msr' */
+static inline u64_t rdmsr (u32_t msr)
+{
+	u64_t val;
+
+	__asm__ __volatile__ ("rdmsr" : "=A" (val) : "c" (msr));
+
+	return val;
+}
+
+/* Write `val' into the model specific register `msr' */
+static inline void wrmsr (u32_t msr, u64_t val)
+{
+	__asm__ __volatile__ ("wrmsr" :: "c" (msr), "A" (val));
+}
+
+/* Execute cpuid for `leaf' */
+static inline void cpuid (u32_t leaf, u32_t *eax, u32_t *ebx,
+			  u32_t *ecx, u32_t *edx)
+{
+	__asm__ __volatile__ ("cpuid"
+			      : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+			      : "0" (leaf), "2" (0));
+}
+
+/* Returns edx of cpuid leaf 1, the standard feature flags */
+static inline u32_t cpu_features (void)
+{
+	u32_t eax, ebx, ecx, edx;
+
+	cpuid (1, &eax, &ebx, &ecx, &edx);
+
+	return edx;
+}
+
+#endif /* __MSR_H__ */
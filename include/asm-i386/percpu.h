@@ -0,0 +1,166 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/asm-i386/percpu.h
+ * Description:   Per processor variables.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __PERCPU_H__
+#define __PERCPU_H__
+
+#include <sys/types.h>
+#include <nodes/config.h>
+
+
+/* Variables declared with DEFINE_PER_CPU go into the .data.percpu
+ * section. The linker script gathers them between __per_cpu_start and
+ * __per_cpu_end. That copy is only a template. At boot every processor
+ * gets its own copy of it (see setup_cpu_area in smp.c), aligned to a
+ * cache line so no two processors ever share one.
+ *
+ * The base of the GS segment of a processor is the distance from the
+ * template to its copy, __per_cpu_offset[cpu]. A per processor
+ * variable is then reached through its plain link time address with a
+ * GS override, so this_cpu_read is a single instruction and can not
+ * be torn by a move to another processor half way through.
+ *
+ * Nothing may use a per processor variable before setup_per_cpu_areas
+ * has run on the processor.
+ */
+
+#define PERCPU_ALIGN  64   /* The size of a cache line */
+
+
+extern char __per_cpu_start[], __per_cpu_end[];
+
+extern u32_t __per_cpu_offset[NR_CPUS];
+
+
+#define DEFINE_PER_CPU(type, name)					\
+	__attribute__ ((section (".data.percpu"))) __typeof__ (type) per_cpu__##name
+
+#define DECLARE_PER_CPU(type, name)					\
+	extern __typeof__ (type) per_cpu__##name
+
+
+/* The copy of `var' that belongs to processor `cpu' */
+#define per_cpu(var, cpu)						\
+	(*(__typeof__ (&per_cpu__##var))				\
+	 ( (u32_t) &per_cpu__##var + __per_cpu_offset[cpu]))
+
+/* A pointer to our own copy of `var'. Only stays ours while
+ * preemption is disabled. */
+#define this_cpu_ptr(var)						\
+	( (__typeof__ (&per_cpu__##var))				\
+	  ( (u32_t) &per_cpu__##var + this_cpu_read (this_cpu_off)))
+
+
+/* Read, write and add to our own copy of a 1, 2 or 4 byte `var'. The
+ * compiler keeps the branches for the other sizes when it does not
+ * optimize, so each uses the register name of its own size. */
+
+#define this_cpu_read(var) ({						\
+	u32_t __val;							\
+									\
+	switch (sizeof (per_cpu__##var)){				\
+	case 1:								\
+		__asm__ __volatile__ ("movzbl %%gs:%1, %0"		\
+				      : "=r" (__val)			\
+				      : "m" (per_cpu__##var));		\
+		break;							\
+	case 2:								\
+		__asm__ __volatile__ ("movzwl %%gs:%1, %0"		\
+				      : "=r" (__val)			\
+				      : "m" (per_cpu__##var));		\
+		break;							\
+	default:							\
+		__asm__ __volatile__ ("movl %%gs:%1, %0"		\
+				      : "=r" (__val)			\
+				      : "m" (per_cpu__##var));		\
+	}								\
+	(__typeof__ (per_cpu__##var)) __val;				\
+})
+
+#define this_cpu_write(var, val) do {					\
+	u32_t __val = (u32_t) (val);					\
+									\
+	switch (sizeof (per_cpu__##var)){				\
+	case 1:								\
+		__asm__ __volatile__ ("movb %b1, %%gs:%0"		\
+				      : "=m" (per_cpu__##var)		\
+				      : "q" (__val));			\
+		break;							\
+	case 2:								\
+		__asm__ __volatile__ ("movw %w1, %%gs:%0"		\
+				      : "=m" (per_cpu__##var)		\
+				      : "r" (__val));			\
+		break;							\
+	default:							\
+		__asm__ __volatile__ ("movl %1, %%gs:%0"		\
+				      : "=m" (per_cpu__##var)		\
+				      : "r" (__val));			\
+	}								\
+} while (0)
+
+#define this_cpu_add(var, val) do {					\
+	u32_t __val = (u32_t) (val);					\
+									\
+	switch (sizeof (per_cpu__##var)){				\
+	case 1:								\
+		__asm__ __volatile__ ("addb %b1, %%gs:%0"		\
+				      : "+m" (per_cpu__##var)		\
+				      : "q" (__val));			\
+		break;							\
+	case 2:								\
+		__asm__ __volatile__ ("addw %w1, %%gs:%0"		\
+				      : "+m" (per_cpu__##var)		\
+				      : "r" (__val));			\
+		break;							\
+	default:							\
+		__asm__ __volatile__ ("addl %1, %%gs:%0"		\
+				      : "+m" (per_cpu__##var)		\
+				      : "r" (__val));			\
+	}								\
+} while (0)
+
+#define this_cpu_inc(var)  this_cpu_add (var, 1)
+#define this_cpu_dec(var)  this_cpu_add (var, -1)
+
+
+DECLARE_PER_CPU (u32_t, cpu_number);    /* Our processor number */
+DECLARE_PER_CPU (u32_t, this_cpu_off);  /* Our __per_cpu_offset */
+
+
+/* Give the boot processor its per processor area and load its GS.
+ * Called first thing in kstart. */
+void setup_per_cpu_areas (void);
+
+#endif /* __PERCPU_H__ */
@@ -0,0 +1,80 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/asm-i386/smp.h
+ * Description:   Starting and talking to the other processors.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __SMP_H__
+#define __SMP_H__
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <asm/gdt.h>
+
+
+/* The application processors start in real mode at a page aligned
+ * address below 1 MB. The trampoline (see trampoline.S) is copied
+ * there. Keep this in sync with TRAMPOLINE_BASE in trampoline.S. */
+#define TRAMPOLINE_BASE  0x70000
+
+
+/* What we keep about every processor */
+
+struct cpu_info {
+	u32_t apic_id;                   /* Its local APIC id */
+	volatile u32_t online;           /* Set once it is running */
+	gdt_desc_t gdt[GDT_ENTRIES];     /* Its own copy of the GDT */
+};
+
+extern struct cpu_info cpu_data[NR_CPUS];
+
+extern u32_t num_online_cpus;   /* Processors 0 to num_online_cpus - 1
+				 * are up */
+
+
+#ifdef CONFIG_SMP
+
+/* Find the other processors in the MP tables and start them. Needs
+ * the local APIC and a calibrated udelay. */
+void smp_init (void);
+
+/* Interrupt processor `cpu' so that it notices need_resched */
+void smp_send_reschedule (u32_t cpu);
+
+#else
+
+#define smp_init()
+#define smp_send_reschedule(cpu)
+
+#endif /* CONFIG_SMP */
+
+#endif /* __SMP_H__ */
@@ -0,0 +1,165 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/asm-i386/spinlock.h
+ * Description:   Ticket spin locks and reader writer locks.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __ASM_SPINLOCK_H__
+#define __ASM_SPINLOCK_H__
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <asm/atomic.h>
+
+
+/* The bare locks. Use the wrappers in nodes/spinlock.h, which also
+ * take care of preemption and the lock statistics.
+ *
+ * On a uniprocessor build there is nobody to spin against, so the
+ * locks have no state and every operation on them is empty. */
+
+#ifdef CONFIG_SMP
+
+/* A ticket lock. The low half of `slock' is the ticket being served,
+ * the high half is the next ticket to hand out. Taking the lock is a
+ * single xadd on the high half followed by a wait for our number
+ * to come up, so waiters get the lock in the order they asked for it.
+ * Only the owner writes the low half, so unlocking needs no lock
+ * prefix. */
+
+typedef struct {
+	volatile u32_t slock;
+} arch_spinlock_t;
+
+#define ARCH_SPIN_LOCK_UNLOCKED  { 0 }
+
+#define TICKET_SHIFT 16
+
+static inline void arch_spin_lock (arch_spinlock_t *lock)
+{
+	u32_t inc = xadd (&lock->slock, 1 << TICKET_SHIFT);
+	u16_t ticket = inc >> TICKET_SHIFT;
+
+	while ( (u16_t) lock->slock != ticket)
+		cpu_relax();
+
+	barrier();
+}
+
+static inline int arch_spin_trylock (arch_spinlock_t *lock)
+{
+	u32_t old = lock->slock;
+
+	if ( (u16_t) old != (u16_t) (old >> TICKET_SHIFT)) return 0;
+
+	return cmpxchg (&lock->slock, old, old + (1 << TICKET_SHIFT)) == old;
+}
+
+static inline void arch_spin_unlock (arch_spinlock_t *lock)
+{
+	__asm__ __volatile__ ("incw %0"
+			      : "+m" (*(volatile u16_t *) &lock->slock)
+			      :: "memory");
+}
+
+static inline int arch_spin_is_locked (arch_spinlock_t *lock)
+{
+	u32_t val = lock->slock;
+
+	return (u16_t) val != (u16_t) (val >> TICKET_SHIFT);
+}
+
+
+/* A reader writer lock. `lock' starts at RW_LOCK_BIAS. Every reader
+ * takes one off it and a writer takes the whole bias, so it is
+ * positive while only readers hold it and exactly RW_LOCK_BIAS when
+ * it is free. A reader or writer that gets it wrong gives its share
+ * back and waits for the lock to look free before it tries again.
+ * Readers can starve writers. */
+
+typedef struct {
+	volatile u32_t lock;
+} arch_rwlock_t;
+
+#define RW_LOCK_BIAS  0x01000000
+
+#define ARCH_RW_LOCK_UNLOCKED  { RW_LOCK_BIAS }
+
+static inline void arch_read_lock (arch_rwlock_t *rw)
+{
+	while ( (s32_t) xadd (&rw->lock, -1) <= 0){
+		xadd (&rw->lock, 1);
+		while ( (s32_t) rw->lock <= 0)
+			cpu_relax();
+	}
+}
+
+static inline void arch_read_unlock (arch_rwlock_t *rw)
+{
+	xadd (&rw->lock, 1);
+}
+
+static inline void arch_write_lock (arch_rwlock_t *rw)
+{
+	while (xadd (&rw->lock, -RW_LOCK_BIAS) != RW_LOCK_BIAS){
+		xadd (&rw->lock, RW_LOCK_BIAS);
+		while (rw->lock != RW_LOCK_BIAS)
+			cpu_relax();
+	}
+}
+
+static inline void arch_write_unlock (arch_rwlock_t *rw)
+{
+	xadd (&rw->lock, RW_LOCK_BIAS);
+}
+
+#else
+
+typedef struct { } arch_spinlock_t;
+typedef struct { } arch_rwlock_t;
+
+#define ARCH_SPIN_LOCK_UNLOCKED  { }
+#define ARCH_RW_LOCK_UNLOCKED    { }
+
+#define arch_spin_lock(lock)       ((void) (lock))
+#define arch_spin_trylock(lock)    ((void) (lock), 1)
+#define arch_spin_unlock(lock)     ((void) (lock))
+#define arch_spin_is_locked(lock)  ((void) (lock), 0)
+
+#define arch_read_lock(rw)         ((void) (rw))
+#define arch_read_unlock(rw)       ((void) (rw))
+#define arch_write_lock(rw)        ((void) (rw))
+#define arch_write_unlock(rw)      ((void) (rw))
+
+#endif /* CONFIG_SMP */
+
+#endif /* __ASM_SPINLOCK_H__ */
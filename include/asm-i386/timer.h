@@ -0,0 +1,61 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/asm-i386/timer.h
+ * Description:   The i8253 PIT and the timer hardware interface.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __ASM_TIMER_H__
+#define __ASM_TIMER_H__
+
+#include <sys/types.h>
+
+#define PIT_HZ       1193182  /* Input clock of the i8253 */
+
+#define PIT_CH0      0x40     /* Channel 0, wired to irq 0 */
+#define PIT_CH2      0x42     /* Channel 2, gated through port B */
+#define PIT_MODE     0x43     /* Mode/command register */
+#define PIT_PORT_B   0x61     /* Gate and output of channel 2 */
+
+#define TIMER_IRQ    0        /* The PIT interrupts on irq 0 */
+
+
+/* Program PIT channel 0 to interrupt every `latch' input clocks */
+void pit_set_periodic (u32_t latch);
+
+/* Busy wait `latch' PIT clocks using channel 2, calling nothing in
+ * between. Used to calibrate other clocks against the PIT. */
+void pit_wait (u32_t latch);
+
+/* Called on every timer tick, from whichever device provides it */
+void timer_tick (void);
+
+#endif /* __ASM_TIMER_H__ */
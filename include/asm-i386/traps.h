@@ -0,0 +1,108 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/asm-i386/traps.h
+ * Description:   Trap frame layout and the CPU exception registration API.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __TRAPS_H__
+#define __TRAPS_H__
+
+#include <sys/types.h>
+
+#define NUM_OF_TRAPS 32  /* Vectors 0-31 are reserved for CPU
+			  * exceptions */
+
+/* The CPU exception vectors */
+#define TRAP_DE   0   /* Divide error */
+#define TRAP_DB   1   /* Debug */
+#define TRAP_NMI  2   /* Non maskable interrupt */
+#define TRAP_BP   3   /* Breakpoint */
+#define TRAP_OF   4   /* Overflow */
+#define TRAP_BR   5   /* BOUND range exceeded */
+#define TRAP_UD   6   /* Invalid opcode */
+#define TRAP_NM   7   /* Device not available (FPU) */
+#define TRAP_DF   8   /* Double fault */
+#define TRAP_TS   10  /* Invalid TSS */
+#define TRAP_NP   11  /* Segment not present */
+#define TRAP_SS   12  /* Stack segment fault */
+#define TRAP_GP   13  /* General protection */
+#define TRAP_PF   14  /* Page fault */
+#define TRAP_MF   16  /* x87 floating point error */
+#define TRAP_AC   17  /* Alignment check */
+#define TRAP_MC   18  /* Machine check */
+#define TRAP_XM   19  /* SIMD floating point */
+
+
+/* The trap frame. Every exception stub in traps_entry.S builds exactly this
+ * layout on the stack, whether or not the CPU pushed an error code,
+ * so handlers never have to care which kind of exception they are
+ * looking at. The fields are in the reverse order of the pushes.
+ */
+
+struct trap_frame {
+	u32_t gs, fs, es, ds;                     /* Pushed by trap_common */
+	u32_t edi, esi, ebp, esp;                 /* Pushed by pusha */
+	u32_t ebx, edx, ecx, eax;
+	u32_t vector;                             /* Pushed by the stub */
+	u32_t error;                              /* By the CPU or the stub */
+	u32_t eip, cs, eflags;                    /* Pushed by the CPU */
+};
+
+
+/* The type of a CPU exception handler */
+
+typedef void (*trap_handler_t) (struct trap_frame *frame);
+
+
+/* The dispatch table that traps_entry.S jumps through. One entry per
+ * vector. Entries that nobody has claimed point at unhandled_trap.
+ */
+
+extern trap_handler_t trap_table[NUM_OF_TRAPS];
+
+
+/* Claim the exception `vector' for `handler'. Returns the previous
+ * handler so that callers can chain to it if they want to. Passing a
+ * null handler restores the default one.
+ */
+trap_handler_t set_trap_handler (u32_t vector, trap_handler_t handler);
+
+
+/* The default handler. Dumps the frame and halts the machine. */
+void unhandled_trap (struct trap_frame *frame);
+
+
+/* Install the exception stubs into the IDT. Called from boot.S while
+ * setting up the IDT. */
+void init_traps (void);
+
+#endif /* __TRAPS_H__ */
@@ -0,0 +1,78 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/elf.h
+ * Description:   The parts of the ELF format the kernel reads.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __ELF_H__
+#define __ELF_H__
+
+#include <sys/types.h>
+
+
+/* A section header. The boot loader hands us the table of them in
+ * the multiboot information, with `sh_addr' set to where it loaded
+ * each section. */
+
+typedef struct elf32_shdr {
+	u32_t sh_name;
+	u32_t sh_type;
+	u32_t sh_flags;
+	u32_t sh_addr;
+	u32_t sh_offset;
+	u32_t sh_size;
+	u32_t sh_link;       /* For a symbol table, its string table */
+	u32_t sh_info;
+	u32_t sh_addralign;
+	u32_t sh_entsize;
+} elf32_shdr_t;
+
+#define SHT_SYMTAB  2
+#define SHT_STRTAB  3
+
+
+/* An entry of a symbol table */
+
+typedef struct elf32_sym {
+	u32_t st_name;       /* Offset into the string table */
+	u32_t st_value;
+	u32_t st_size;
+	u8_t st_info;        /* Binding and type */
+	u8_t st_other;
+	u16_t st_shndx;
+} elf32_sym_t;
+
+#define ELF32_ST_TYPE(info)  ( (info) & 0xf)
+
+#define STT_FUNC  2
+
+#endif /* __ELF_H__ */
@@ -37,26 +37,35 @@
 #define __IO_H__
 
 #include <asm/io.h>
+#include <stdarg.h>
 
 
-/* The screen structure. Maintains the current cursor position, the
- * total rows and columns and a pointer to the video memory.
- * It also holds the attributes (foreground and background colour) for
- * all characters that are displayed on the screen
+/* The state of a console. Maintains the current cursor position, the
+ * total rows and columns and the attributes (foreground and
+ * background colour) for the characters that are printed on it.
+ *
+ * What is on a console is kept in a shadow copy in memory, together
+ * with the lines that scrolled off the top. Lines are numbered from
+ * the first one ever printed, and `top' is the number of the line on
+ * the first row.
  */
  
 
 typedef struct screen{
-	unsigned int xpos;
-	unsigned int ypos;
+	unsigned int xpos;    /* The row of the cursor */
+	unsigned int ypos;    /* The column of the cursor */
 
 	unsigned int rows;
 	unsigned int cols;
 
-	volatile unsigned char* video;
 	char attribute ;
+
+	u32_t top;            /* The line on the first row */
+	u32_t back;           /* Lines the view is scrolled back by */
 } screen;
 
+#define NR_CONSOLES  4   /* Switched between with Alt+F1 and on */
+
 /* Forward declarations.  */
 
 /* Clears the screen */
@@ -70,15 +79,89 @@ void cls (void);
 void putchar (char c );
 
 /* Format a string and print it on the screen, just like the libc
-   function printf.  */
+   function printf. Conversions are d i u x X p c s and %, with the
+   flags - 0 + space #, a width and a precision (either may be *) and
+   the lengths h hh l ll z. Returns the number of characters printed. */
+
+int printf (const char *format, ...);
+int vprintf (const char *format, va_list ap);
+
+/* Format into `buf', which holds `size' bytes including the
+ * terminator. Returns the length the whole string would have had. */
+
+int snprintf (char *buf, u32_t size, const char *format, ...);
+int vsnprintf (char *buf, u32_t size, const char *format, va_list ap);
+
+/* Print `what' of a boot time check with the value it came out as,
+ * `got', and whether that is the one it should be, `want' */
 
-void printf (const char *format, ...);
+void boot_check (const char *what, int got, int want);
 
-/* Initializes the screen whose properties are in global varible scr
- * of type screen.
+/* Compare printf with the one it replaced */
+
+void bench_printf (void);
+
+/* The old uncached putchar, for bench_printf. Call it between
+ * console_begin and console_end. */
+
+void legacy_putchar (char c);
+
+/* Initializes all the consoles with `rows' and `cols' of text in
+ * `attribute', on the VGA text display.
  */
 
 void init_screen ( unsigned int rows, unsigned int cols, char attribute);
 
 
+/* Writers that put out more than one character take the console with
+ * console_begin, write with console_putc and give it back with
+ * console_end, which also brings the screen up to date. putchar does
+ * all three for a single character. */
+
+u32_t console_begin (void);
+void console_putc (char c);
+void console_write (const char *s, u32_t n);
+void console_end (u32_t flags);
+
+/* A display is what the console is shown on. Its memory holds
+ * `lines' lines of `cols' cells, of which the `rows' from the origin
+ * on are on the screen. Lines are drawn a run of cells at a time,
+ * with the console held. A display that has no cursor of its own
+ * sets `soft_cursor', and `cursor' then draws the cell under it so
+ * it stands out; the console draws the cell plain again once the
+ * cursor moves on. */
+
+#define MAX_COLS  160   /* The widest display the console can use */
+
+struct display {
+	const char *name;
+	u32_t rows;
+	u32_t cols;
+	u32_t lines;
+	u32_t soft_cursor;
+
+	void (*draw) (u32_t line, u32_t col, const u16_t *cells, u32_t n);
+	void (*set_origin) (u32_t line);   /* Show `line' on top */
+	void (*cursor) (u32_t line, u32_t col, u16_t cell);
+};
+
+/* Move the console onto the display `d' */
+void console_set_display (struct display *d);
+
+/* Scroll the view `lines' back into the history, or forward if it is
+ * negative. Printing anything scrolls it back to the bottom. */
+
+void console_scroll (int lines);
+
+
+/* The kernel console is console 0. The others are written to with
+ * vc_write, which takes and gives back the console itself. */
+
+void vc_write (u32_t console, const char *s, u32_t n);
+
+/* Bring `console' onto the display, and ask which one is on it */
+void console_switch (u32_t console);
+u32_t console_foreground (void);
+
+
 #endif /* __IO_H__ */
@@ -46,7 +46,10 @@
 
 
 
-#define LOW_MEM_ZONE 0   /* The lower memory zone */
+#define LOW_MEM_ZONE 0   /* The lower memory zone. Its pages are
+			  * identity mapped, so the address
+			  * returned by allocate_page can be
+			  * used as a pointer directly. */
 
 #define HIGH_MEM_ZONE 1  /* The higher memory zone */
 
@@ -121,6 +124,19 @@ u32_t allocate_page (u32_t zone);
 void deallocate_page (u32_t addr);
 
 
+/* Put the per processor page caches in front of the free page
+ * stacks. Called once the boot processor can reach its per processor
+ * variables. */
+
+void enable_page_magazines (void);
+
+
+/* Time allocating and freeing pages on one to all processors, with
+ * and without the per processor caches. */
+
+void bench_page_alloc (void);
+
+
 /* This function returns the page aligned physical end address of the
  * kernel which also accounts for the space taken by the page
  * allocator. The page allocator is given space right after the end of
@@ -90,7 +90,43 @@ typedef struct multiboot_info
 	} u;
 	u32_t mmap_length;
 	u32_t mmap_addr;
-} multiboot_info_t;
+
+	/* The rest is only there with newer loaders. Bit 11 of flags
+	 * says the VBE fields are valid and bit 12 the framebuffer
+	 * ones. */
+	u32_t drives_length;
+	u32_t drives_addr;
+	u32_t config_table;
+	u32_t boot_loader_name;
+	u32_t apm_table;
+
+	u32_t vbe_control_info;
+	u32_t vbe_mode_info;
+	u16_t vbe_mode;
+	u16_t vbe_interface_seg;
+	u16_t vbe_interface_off;
+	u16_t vbe_interface_len;
+
+	u64_t framebuffer_addr;
+	u32_t framebuffer_pitch;    /* Bytes from a line to the next */
+	u32_t framebuffer_width;    /* In pixels, or characters */
+	u32_t framebuffer_height;
+	u8_t framebuffer_bpp;
+	u8_t framebuffer_type;      /* See MULTIBOOT_FRAMEBUFFER_* */
+	u8_t red_field_position;    /* Where the colours are in a pixel, */
+	u8_t red_mask_size;         /* for the RGB type */
+	u8_t green_field_position;
+	u8_t green_mask_size;
+	u8_t blue_field_position;
+	u8_t blue_mask_size;
+} __attribute__ ((packed)) multiboot_info_t;
+
+#define MULTIBOOT_INFO_ELF_SHDR      5   /* The bits in flags */
+#define MULTIBOOT_INFO_FRAMEBUFFER  12
+
+#define MULTIBOOT_FRAMEBUFFER_INDEXED  0
+#define MULTIBOOT_FRAMEBUFFER_RGB      1
+#define MULTIBOOT_FRAMEBUFFER_TEXT     2
 
 /* The module structure.  */
 typedef struct module
@@ -0,0 +1,88 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/config.h
+ * Description:   Compile time configuration of the kernel. Change the
+ *                values here and rebuild.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __CONFIG_H__
+#define __CONFIG_H__
+
+
+#define HZ 100  /* Frequency of the timer tick */
+
+
+#define CONFIG_LOCAL_APIC  /* Use the local APIC timer for the tick
+			    * when the processor has one. #undef it
+			    * to always use the PIT. */
+
+#define CONFIG_NO_HZ       /* Stop the periodic tick while the
+			    * processor is idle */
+
+#define CONFIG_SMP         /* Start the other processors too */
+
+#ifdef CONFIG_SMP
+#define NR_CPUS  16        /* Most processors we can drive */
+#else
+#define NR_CPUS  1
+#endif /* CONFIG_SMP */
+
+#define CONFIG_FBCON       /* Move the console to a framebuffer
+			    * when there is one */
+
+#undef CONFIG_BENCH        /* Set this to run the kernel benchmarks
+			    * at the end of boot */
+
+#undef CONFIG_LOCK_STAT    /* Set this to count acquisitions, spin
+			    * cycles and hold times of every spin
+			    * lock and print them at the end of boot */
+
+#undef CONFIG_TRACE        /* Set this to compile the tracepoints in.
+			    * They record from boot on, and Ctrl+F12
+			    * dumps them on the serial port for
+			    * tools/tracedump */
+
+#undef CONFIG_PROFILE      /* Set this to sample where the kernel
+			    * spends its time on every tick. Ctrl+F11
+			    * prints the busiest functions on the
+			    * serial port */
+
+/* CONFIG_INSTRUMENT is not set here. The Makefile sets it when it is
+ * asked to build directories with -finstrument-functions, see
+ * INSTRUMENT in there and kernel/callgraph.c. */
+
+#if defined (CONFIG_PROFILE) || defined (CONFIG_INSTRUMENT)
+#define CONFIG_KSYMS       /* The profilers need the names of the
+			    * kernel functions */
+#endif
+
+#endif /* __CONFIG_H__ */
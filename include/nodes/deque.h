@@ -0,0 +1,133 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/deque.h
+ * Description:   A lock free work stealing deque.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __DEQUE_H__
+#define __DEQUE_H__
+
+#include <sys/types.h>
+#include <asm/atomic.h>
+
+
+/* The deque of Chase and Lev. One owner pushes and pops items at the
+ * bottom, any number of thieves take them from the top. The owner
+ * only needs a compare and swap when it races a thief for the last
+ * item, thieves need one per steal. Nobody takes a lock.
+ *
+ * top and bottom only ever grow. The items live in a fixed ring of
+ * WS_DEQUE_SIZE slots, so a push fails when the ring is full.
+ */
+
+#define WS_DEQUE_SIZE  64   /* Must be a power of two */
+
+struct ws_deque {
+	volatile u32_t top;      /* Next item to steal */
+	volatile u32_t bottom;   /* Next free slot */
+	void *volatile items[WS_DEQUE_SIZE];
+};
+
+
+static inline void ws_deque_init (struct ws_deque *dq)
+{
+	dq->top = dq->bottom = 0;
+}
+
+/* Number of items, as seen by anyone. Only a hint for thieves. */
+static inline u32_t ws_deque_size (struct ws_deque *dq)
+{
+	s32_t size = dq->bottom - dq->top;
+
+	return size < 0 ? 0 : size;
+}
+
+/* Owner only. Returns 0 if the deque is full. */
+static inline int ws_push (struct ws_deque *dq, void *item)
+{
+	u32_t b = dq->bottom;
+
+	if (b - dq->top >= WS_DEQUE_SIZE) return 0;
+
+	dq->items[b & (WS_DEQUE_SIZE - 1)] = item;
+	wmb();
+	dq->bottom = b + 1;
+
+	return 1;
+}
+
+/* Owner only. Takes the item pushed last, or returns null. */
+static inline void *ws_pop (struct ws_deque *dq)
+{
+	u32_t b = dq->bottom - 1, t;
+	void *item;
+
+	/* Claim the slot before looking at top, or a thief that read
+	 * the old bottom could take the same item. */
+	dq->bottom = b;
+	mb();
+	t = dq->top;
+
+	if ( (s32_t) (b - t) < 0){
+		dq->bottom = b + 1;
+		return 0;
+	}
+
+	item = dq->items[b & (WS_DEQUE_SIZE - 1)];
+	if (b != t) return item;
+
+	/* The last item. Whoever moves top first gets it. */
+	if (cmpxchg (&dq->top, t, t + 1) != t) item = 0;
+	dq->bottom = t + 1;
+
+	return item;
+}
+
+/* Anyone. Takes the oldest item, or returns null if the deque is
+ * empty or another thief or the owner got there first. */
+static inline void *ws_steal (struct ws_deque *dq)
+{
+	u32_t t = dq->top, b;
+	void *item;
+
+	mb();
+	b = dq->bottom;
+
+	if ( (s32_t) (b - t) <= 0) return 0;
+
+	item = dq->items[t & (WS_DEQUE_SIZE - 1)];
+	if (cmpxchg (&dq->top, t, t + 1) != t) return 0;
+
+	return item;
+}
+
+#endif /* __DEQUE_H__ */
@@ -36,7 +36,22 @@
 #ifndef __DEVICES_H__
 #define __DEVICES_H__
 
+#include <sys/types.h>
+
 /* Initialize the keyboard */
 void kb_init (void);
 
+/* Set the first serial port up and make it a sink of the kernel log.
+ * Output is polled until serial_init_irq, which needs the scheduler,
+ * switches it to interrupts and starts taking input. */
+void serial_init (void);
+void serial_init_irq (void);
+
+/* Write `n' bytes to the serial port. Sleeps while the transmit ring
+ * is full, unless interrupts are off. */
+void serial_write (const char *s, u32_t n);
+
+/* Move the console to a framebuffer, if there is one we can use */
+void init_fbcon (void);
+
 #endif /* __DEVICES_H__ */
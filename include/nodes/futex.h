@@ -0,0 +1,81 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/futex.h
+ * Description:   Fast user space locking.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __FUTEX_H__
+#define __FUTEX_H__
+
+#include <sys/types.h>
+
+
+/* A futex is a 32 bit word that a lock or a condition lives in.
+ * Taking and releasing an uncontended lock is an atomic operation on
+ * the word and never enters the kernel. Only a thread that has to
+ * wait asks the kernel to put it to sleep on the word, and only a
+ * thread that sees there may be waiters asks it to wake them.
+ *
+ * Waiters are found by the physical address of the word, so threads
+ * that map it at different virtual addresses still meet.
+ */
+
+#define FUTEX_WAIT     0   /* Sleep if the word still holds `val' */
+#define FUTEX_WAKE     1   /* Wake up to `val' sleepers */
+#define FUTEX_REQUEUE  2   /* Wake up to `val' sleepers and move up
+			    * to `val2' of the others to `uaddr2' */
+
+
+/* Sleep on `uaddr' if it holds `val'. Checking and going to sleep are
+ * atomic with respect to futex_wake. Returns 0 once woken, -EAGAIN if
+ * the word held something else and -EFAULT if it is not mapped. */
+int futex_wait (u32_t *uaddr, u32_t val);
+
+/* Wake up to `nr' threads sleeping on `uaddr'. Returns the number
+ * woken or -EFAULT. */
+int futex_wake (u32_t *uaddr, u32_t nr);
+
+/* Wake up to `nr_wake' threads sleeping on `uaddr' and move up to
+ * `nr_requeue' of the rest to `uaddr2' without waking them. A
+ * condition variable uses it to hand waiters over to its mutex
+ * instead of waking them all to fight for it. Returns the number
+ * woken plus the number moved, or -EFAULT. */
+int futex_requeue (u32_t *uaddr, u32_t nr_wake, u32_t nr_requeue,
+		   u32_t *uaddr2);
+
+/* The system call. Dispatches `op' to the functions above. Returns
+ * -EINVAL for an unknown `op'. */
+int do_futex (u32_t *uaddr, u32_t op, u32_t val, u32_t val2, u32_t *uaddr2);
+
+void init_futex (void);
+
+#endif /* __FUTEX_H__ */
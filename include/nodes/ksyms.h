@@ -0,0 +1,71 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/ksyms.h
+ * Description:   The names of the functions of the kernel.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __KSYMS_H__
+#define __KSYMS_H__
+
+#include <sys/types.h>
+#include <nodes/config.h>
+
+
+/* A table of the functions in .text, read from the symbol table of
+ * the kernel that the boot loader passes in the multiboot
+ * information. Only built for the profilers, which need it. */
+
+#define KSYM_MAX   1024         /* Functions we can tell apart */
+#define KSYM_NONE  KSYM_MAX     /* Not in any function we know */
+
+#ifdef CONFIG_KSYMS
+
+/* Read the symbol table. Needs paging. */
+void init_ksyms (void);
+
+/* The number of the function `addr' is in, or KSYM_NONE. Functions
+ * are numbered from 0 in the order of their addresses. */
+u32_t ksym_lookup (u32_t addr);
+
+/* The name of function `n', which may be KSYM_NONE */
+const char *ksym_name (u32_t n);
+
+/* The number of functions in the table */
+u32_t ksym_count (void);
+
+#else
+
+static inline void init_ksyms (void) { }
+
+#endif /* CONFIG_KSYMS */
+
+#endif /* __KSYMS_H__ */
@@ -0,0 +1,141 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/list.h
+ * Description:   Intrusive circular doubly linked lists.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __LIST_H__
+#define __LIST_H__
+
+#include <sys/types.h>
+
+/* The list node is embedded in the object that is put on the list,
+ * so putting an object on a list never allocates memory. A list head
+ * is just a node with no object around it. An empty list points to
+ * itself.
+ */
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+
+
+/* Get the object of type `type' in which `ptr' is the `member' */
+
+#define container_of(ptr, type, member)					\
+	((type *) ( (char *) (ptr) - (u32_t) &((type *) 0)->member))
+
+#define list_entry(ptr, type, member) container_of (ptr, type, member)
+
+
+/* Iterate over a list. The _safe variant allows the current entry
+ * to be removed. */
+
+#define list_for_each(pos, head)					\
+	for (pos = (head)->next; pos != (head); pos = pos->next)
+
+#define list_for_each_safe(pos, n, head)				\
+	for (pos = (head)->next, n = pos->next; pos != (head);		\
+	     pos = n, n = pos->next)
+
+
+static inline void INIT_LIST_HEAD (struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void __list_add (struct list_head *new,
+			       struct list_head *prev,
+			       struct list_head *next)
+{
+	next->prev = new;
+	new->next = next;
+	new->prev = prev;
+	prev->next = new;
+}
+
+/* Add `new' right after `head' */
+static inline void list_add (struct list_head *new, struct list_head *head)
+{
+	__list_add (new, head, head->next);
+}
+
+/* Add `new' right before `head', ie. at the tail of the list */
+static inline void list_add_tail (struct list_head *new, struct list_head *head)
+{
+	__list_add (new, head->prev, head);
+}
+
+/* Unlink `entry'. It is left pointing nowhere. */
+static inline void list_del (struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	entry->next = 0;
+	entry->prev = 0;
+}
+
+/* Unlink `entry' and make it an empty list */
+static inline void list_del_init (struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	INIT_LIST_HEAD (entry);
+}
+
+static inline int list_empty (const struct list_head *head)
+{
+	return head->next == head;
+}
+
+/* Move all the entries of `old' onto `new' and make `old' empty.
+ * Whatever was on `new' is forgotten. */
+static inline void list_replace_init (struct list_head *old,
+				      struct list_head *new)
+{
+	if (list_empty (old)){
+		INIT_LIST_HEAD (new);
+		return;
+	}
+
+	new->next = old->next;
+	new->next->prev = new;
+	new->prev = old->prev;
+	new->prev->next = new;
+	INIT_LIST_HEAD (old);
+}
+
+#endif /* __LIST_H__ */
@@ -0,0 +1,126 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/log.h
+ * Description:   The kernel log
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __LOG_H__
+#define __LOG_H__
+
+#include <sys/types.h>
+#include <stdarg.h>
+
+
+/* The kernel log is a ring of records that any processor may add to
+ * at any time, interrupt handlers included, without taking a lock or
+ * waiting for anything. The records are written out to the sinks
+ * later on by the klogd thread, so a slow console does not hold up
+ * whoever logged the message. Records stay in the ring until newer
+ * ones overwrite them and can be read back with log_read.
+ *
+ * Every record has a sequence number, which only ever goes up, a time
+ * stamp in nanoseconds since boot and a level. The levels are those
+ * of syslog.
+ */
+
+#define LOG_EMERG    0   /* The system is going down */
+#define LOG_ALERT    1
+#define LOG_CRIT     2
+#define LOG_ERR      3
+#define LOG_WARNING  4
+#define LOG_NOTICE   5
+#define LOG_INFO     6
+#define LOG_DEBUG    7
+
+#define LOG_TEXT_SIZE  112   /* Longer messages are cut short */
+
+struct log_record {
+	volatile u32_t seq;   /* Only equals the sequence number of the
+			       * record once it is complete */
+	u8_t level;
+	u8_t cpu;             /* The processor that logged it */
+	u16_t len;            /* Characters in text */
+	u64_t stamp;          /* ktime when it was logged */
+	char text[LOG_TEXT_SIZE];
+};
+
+
+/* A sink is somewhere the log is written out to, a line at a time.
+ * Every sink keeps its own place in the log, so a slow one does not
+ * hold up the rest, and one registered late starts with the oldest
+ * record still in the ring. */
+
+struct log_sink {
+	const char *name;
+	void (*write) (const char *s, u32_t n);
+	u32_t level;            /* Records above this level are skipped */
+
+	u32_t seq;              /* The next record to write out */
+	u32_t midline;          /* The last one did not end its line */
+	struct log_sink *next;
+};
+
+
+/* Log a message at `level'. Never sleeps or spins on a lock, so it
+ * may be called from anywhere, and returns the number of characters
+ * logged. */
+int printk (u32_t level, const char *format, ...);
+int vprintk (u32_t level, const char *format, va_list ap);
+
+void register_log_sink (struct log_sink *sink);
+
+/* Write out whatever the sinks have not written yet, here and now.
+ * Does nothing if someone else is already at it. */
+void log_flush (void);
+
+/* Called when the system is about to die. From then on every message
+ * is written out before printk returns. */
+void log_panic (void);
+
+/* The sequence number of the oldest record still in the log and of
+ * the next one to be logged */
+u32_t log_first_seq (void);
+u32_t log_next_seq (void);
+
+/* Copy record `*seq' to `rec' and move `*seq' on past it. If the
+ * record has been overwritten, the oldest one there is is read
+ * instead and rec->seq tells which. Returns 0, with nothing copied,
+ * if there is no record `*seq' yet. */
+int log_read (u32_t *seq, struct log_record *rec);
+
+/* Print the whole log on the console */
+void dmesg (void);
+
+/* Start klogd. Until then printk writes messages out itself. */
+void init_log (void);
+
+#endif /* __LOG_H__ */
@@ -0,0 +1,92 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/mutex.h
+ * Description:   Sleeping locks that spin while their owner runs.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __MUTEX_H__
+#define __MUTEX_H__
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/sched.h>
+#include <nodes/spinlock.h>
+#include <nodes/wait.h>
+
+
+/* A mutex is for locks that may be held for long or across a sleep,
+ * where a spin lock would burn the processors of its waiters. It is
+ * free when `owner' is null. Taking a free mutex is one compare and
+ * swap.
+ *
+ * A task that finds it taken spins for as long as the owner is
+ * running on another processor, since then it is likely to let go
+ * soon and a sleep and wakeup would cost more than the wait. Once the
+ * owner is not running, or we are asked to reschedule, it sleeps on
+ * `wait'. An unlock wakes one sleeper, which then has to take the
+ * mutex like everybody else.
+ *
+ * Only the owner may unlock it. It must not be used from interrupt
+ * handlers. With CONFIG_LOCK_STAT it keeps the same statistics as a
+ * spin lock, with the time spent sleeping counted as waiting.
+ */
+
+struct mutex {
+	struct task *volatile owner;
+	struct wait_queue_head wait;
+#ifdef CONFIG_LOCK_STAT
+	struct lock_stat stat;
+#endif /* CONFIG_LOCK_STAT */
+};
+
+#define MUTEX_INIT(name)						\
+	{ 0, WAIT_QUEUE_HEAD_INIT ((name).wait) LOCK_STAT_INIT (#name) }
+
+#define DEFINE_MUTEX(name)  struct mutex name = MUTEX_INIT (name)
+
+#define mutex_init(m)  __mutex_init (m, #m)
+
+void __mutex_init (struct mutex *m, const char *name);
+
+void mutex_lock (struct mutex *m);
+
+/* Returns 1 if it took the mutex, 0 if it is taken */
+int mutex_trylock (struct mutex *m);
+
+void mutex_unlock (struct mutex *m);
+
+static inline int mutex_is_locked (struct mutex *m)
+{
+	return m->owner != 0;
+}
+
+#endif /* __MUTEX_H__ */
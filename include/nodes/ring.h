@@ -0,0 +1,144 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/ring.h
+ * Description:   A lock free single producer, single consumer ring.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __RING_H__
+#define __RING_H__
+
+#include <sys/types.h>
+#include <asm/atomic.h>
+
+
+/* A ring of fixed size elements with one producer and one consumer,
+ * for example an interrupt handler and the thread that drains it.
+ * Neither side takes a lock or disables interrupts, so a producer in
+ * an interrupt handler never waits.
+ *
+ * head and tail only ever grow and are reduced to a slot with `mask',
+ * so the number of slots must be a power of two and all of them can
+ * be used. Only the producer writes head and only the consumer
+ * writes tail. The producer fills a slot before it publishes the new
+ * head, the consumer empties one before it publishes the new tail.
+ * They live on their own cache lines so the two sides do not steal
+ * each other's line on every element.
+ *
+ * A put into a full ring fails and is counted in `dropped'. What to
+ * do about it is up to the producer.
+ */
+
+#define RING_ALIGN  64   /* The size of a cache line */
+
+struct ring {
+	volatile u32_t head;     /* Next slot to fill */
+	u32_t dropped;           /* Puts that found the ring full */
+
+	volatile u32_t tail __attribute__ ((aligned (RING_ALIGN)));
+				 /* Next slot to empty */
+
+	u32_t mask __attribute__ ((aligned (RING_ALIGN)));
+				 /* Number of slots - 1 */
+	u32_t esize;             /* Size of an element in bytes */
+	u8_t *buf;               /* (mask + 1) * esize bytes */
+};
+
+/* Define a ring `name', local to the file, with a buffer of `slots'
+ * elements of `type' */
+#define DEFINE_RING(name, type, slots)					\
+	static u8_t name##_buf[(slots) * sizeof (type)];		\
+	static struct ring name =					\
+		{ 0, 0, 0, (slots) - 1, sizeof (type), name##_buf }
+
+
+/* Use the `slots' * `esize' bytes at `buf'. `slots' must be a power
+ * of two. */
+static inline void ring_init (struct ring *r, void *buf, u32_t slots, u32_t esize)
+{
+	r->head = r->tail = 0;
+	r->dropped = 0;
+	r->mask = slots - 1;
+	r->esize = esize;
+	r->buf = buf;
+}
+
+/* Elements in the ring. Exact for the consumer, a lower bound for
+ * the producer, a hint for anyone else. */
+static inline u32_t ring_count (struct ring *r)
+{
+	return r->head - r->tail;
+}
+
+static inline int ring_empty (struct ring *r)
+{
+	return r->head == r->tail;
+}
+
+
+static inline void __ring_copy (u8_t *to, const u8_t *from, u32_t n)
+{
+	while (n--) *to++ = *from++;
+}
+
+
+/* Producer only. Copies `elem' into the ring. Returns 0 if it is
+ * full. */
+static inline int ring_put (struct ring *r, const void *elem)
+{
+	u32_t head = r->head;
+
+	if (head - load_acquire (&r->tail) > r->mask){
+		r->dropped++;
+		return 0;
+	}
+
+	__ring_copy (r->buf + (head & r->mask) * r->esize, elem, r->esize);
+	store_release (&r->head, head + 1);
+
+	return 1;
+}
+
+/* Consumer only. Copies the oldest element into `elem'. Returns 0 if
+ * the ring is empty. */
+static inline int ring_get (struct ring *r, void *elem)
+{
+	u32_t tail = r->tail;
+
+	if (load_acquire (&r->head) == tail) return 0;
+
+	__ring_copy (elem, r->buf + (tail & r->mask) * r->esize, r->esize);
+	store_release (&r->tail, tail + 1);
+
+	return 1;
+}
+
+#endif /* __RING_H__ */
@@ -0,0 +1,201 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/sched.h
+ * Description:   Kernel threads and the scheduler.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __SCHED_H__
+#define __SCHED_H__
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/list.h>
+#include <asm/percpu.h>
+#include <mm/mm.h>
+
+
+#define THREAD_SIZE PAGE_SIZE_BYTES  /* Size of a kernel stack */
+
+/* Task states */
+#define TASK_RUNNING  0   /* Running or on the run queue */
+#define TASK_BLOCKED  1   /* Waiting for wake_up_task */
+#define TASK_DEAD     2   /* Exited, stack to be freed */
+
+/* Priorities. Lower numbers are more important. One bit of the run
+ * queue bitmap per priority, so there can be at most 32. The idle
+ * task sits below all of them and is never queued. */
+#define MAX_PRIO       32
+#define IDLE_PRIO      MAX_PRIO
+#define DEFAULT_PRIO   16   /* What kthread_create gives a thread */
+#define IRQ_THREAD_PRIO 4   /* Threaded irq handlers */
+
+#define DEF_TIMESLICE  (HZ / 10)   /* Ticks a task runs before it has
+				    * to let others of its priority in */
+
+
+/* A kernel thread. Each thread gets one page from the page allocator.
+ * The task structure sits at the bottom of the page and the stack
+ * grows down towards it from the top. That is also how a processor
+ * finds the task it is running, see get_current.
+ */
+
+struct task {
+	u32_t esp;                  /* Saved stack pointer. Must be
+				     * first, switch.S relies on it. */
+	u32_t state;
+	u32_t id;
+	const char *name;
+
+	u32_t prio;                 /* 0 to MAX_PRIO - 1 */
+	u32_t time_slice;           /* Ticks left before preemption */
+	u32_t need_resched;         /* Set when a more important task
+				     * is waiting or the slice ran out */
+	u32_t preempt_count;        /* Preemption is off while not 0 */
+
+	u32_t cpu;                  /* The processor whose run queue
+				     * the task belongs to */
+	u32_t on_rq;                /* Runnable: running, queued or
+				     * offered for stealing */
+	u32_t pinned;               /* Never move to another processor */
+
+	struct list_head run_list;  /* Links the task into the run
+				     * queue of its priority */
+
+	void (*fn) (void *arg);     /* The function the thread runs */
+	void *arg;
+};
+
+
+/* Returns the task that is running on this processor. The stack
+ * pointer is always inside the page of the current task, so this is
+ * a single and, and it can not go stale even if the task is moved to
+ * another processor half way through. */
+
+static inline struct task *get_current (void)
+{
+	u32_t esp;
+
+	__asm__ ("movl %%esp, %0" : "=r" (esp));
+
+	return (struct task *) (esp & ~(THREAD_SIZE - 1));
+}
+
+#define current get_current()
+
+/* The processor we are running on. Only stable while preemption or
+ * interrupts are disabled. */
+#define smp_processor_id() this_cpu_read (cpu_number)
+
+
+/* Disable and enable preemption from interrupts. Calls nest. The
+ * task may still block or yield on its own. */
+
+#define preempt_disable() do { current->preempt_count++; } while (0)
+
+#define preempt_enable() do {						\
+	if (--current->preempt_count == 0 && current->need_resched)	\
+		preempt_schedule();					\
+} while (0)
+
+
+/* Create a kernel thread that runs fn(arg) at DEFAULT_PRIO and make
+ * it runnable. Returns null if there is no memory for its stack. */
+struct task *kthread_create (void (*fn) (void *), void *arg, const char *name);
+
+/* Like kthread_create, but the thread runs on processor `cpu' and is
+ * never moved. Returns null if that processor is not online. */
+struct task *kthread_create_on_cpu (void (*fn) (void *), void *arg,
+				    const char *name, u32_t cpu);
+
+/* End the calling thread. Returning from its function does the same. */
+void kthread_exit (void);
+
+/* Give up the processor to the next runnable task, if there is one */
+void yield (void);
+
+/* Pick the most important runnable task and switch to it. If the
+ * current task is still TASK_RUNNING it goes to the back of the queue
+ * of its priority, otherwise it stays off the run queue until woken. */
+void schedule (void);
+
+/* Make a blocked task runnable again. Safe from interrupt handlers.
+ * Preempts the current task if `task' is more important. */
+void wake_up_task (struct task *task);
+
+/* Change the priority of `task' */
+void set_task_prio (struct task *task, u32_t prio);
+
+/* Returns true if the current task should call schedule */
+static inline int need_resched (void)
+{
+	return current->need_resched;
+}
+
+/* Charge the tick to the current task. Called from timer_tick. */
+void scheduler_tick (void);
+
+/* Switch away from the current task if it has been asked to. Called on
+ * the way out of every interrupt, see irq_exit. */
+void preempt_schedule_irq (void);
+
+/* Switch away from the current task, which stays runnable whatever
+ * its state. Used by preempt_enable. */
+void preempt_schedule (void);
+
+/* Turn the boot context into the idle task */
+void init_sched (void);
+
+/* Create the idle task of processor `cpu'. Its stack is what the
+ * processor boots on. Returns null if there is no memory for it. */
+struct task *fork_idle (u32_t cpu);
+
+/* The idle loop, run by the idle task of every processor. Never
+ * returns. Defined in kernel/idle.c. */
+void cpu_idle (void);
+
+/* Returns true if `task' is running on its processor right now */
+int task_on_cpu (struct task *task);
+
+/* Returns true if another processor has offered tasks to steal. The
+ * idle loop checks this before halting. */
+int sched_work_available (void);
+
+/* Measure a context switch with two threads yielding to each other,
+ * and the cost of picking the next task against the number queued */
+void bench_sched (void);
+
+
+/* Switch from `prev' to `next' and return the task that was running
+ * before we got back to `prev'. Defined in switch.S. */
+struct task *switch_to (struct task *prev, struct task *next);
+
+#endif /* __SCHED_H__ */
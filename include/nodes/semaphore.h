@@ -0,0 +1,95 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/semaphore.h
+ * Description:   Counting semaphores and completions.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __SEMAPHORE_H__
+#define __SEMAPHORE_H__
+
+#include <sys/types.h>
+#include <nodes/wait.h>
+
+
+/* A semaphore counts free units of something. down takes one and
+ * sleeps while there are none, up gives one back and wakes one
+ * sleeper. Unlike a mutex it has no owner, so any task may up it.
+ * up may be called from an interrupt handler.
+ */
+
+struct semaphore {
+	volatile u32_t count;
+	struct wait_queue_head wait;
+};
+
+#define SEMAPHORE_INIT(name, n)						\
+	{ n, WAIT_QUEUE_HEAD_INIT ((name).wait) }
+
+#define DEFINE_SEMAPHORE(name, n)					\
+	struct semaphore name = SEMAPHORE_INIT (name, n)
+
+void sema_init (struct semaphore *sem, u32_t n);
+
+void down (struct semaphore *sem);
+
+/* Returns 1 if it took a unit, 0 if there was none */
+int down_trylock (struct semaphore *sem);
+
+void up (struct semaphore *sem);
+
+
+/* A completion is how one task waits for another to finish
+ * something. complete lets one waiter through, or the next task to
+ * wait if nobody is waiting yet. complete_all lets everyone through
+ * from then on. complete may be called from an interrupt handler.
+ */
+
+struct completion {
+	volatile u32_t done;
+	struct wait_queue_head wait;
+};
+
+#define COMPLETION_INIT(name)						\
+	{ 0, WAIT_QUEUE_HEAD_INIT ((name).wait) }
+
+#define DECLARE_COMPLETION(name)					\
+	struct completion name = COMPLETION_INIT (name)
+
+void init_completion (struct completion *x);
+
+void wait_for_completion (struct completion *x);
+
+void complete (struct completion *x);
+
+void complete_all (struct completion *x);
+
+#endif /* __SEMAPHORE_H__ */
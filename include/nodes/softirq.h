@@ -0,0 +1,76 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/softirq.h
+ * Description:   Deferred work that runs on the way out of an interrupt
+ *                with interrupts enabled.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __SOFTIRQ_H__
+#define __SOFTIRQ_H__
+
+#include <sys/types.h>
+
+
+/* The softirq numbers. Lower numbers run first. */
+
+#define TIMER_SOFTIRQ      0   /* Expiry of kernel timers */
+#define LOG_SOFTIRQ        1   /* Wakes klogd */
+
+#define NUM_OF_SOFTIRQS    8
+
+
+/* The type of a softirq handler */
+
+typedef void (*softirq_handler_t) (void);
+
+
+/* Install `handler' for softirq `nr' */
+void open_softirq (u32_t nr, softirq_handler_t handler);
+
+/* Mark softirq `nr' pending. It runs on the next irq_exit. Must be
+ * called with interrupts disabled, which is always true inside a
+ * hard irq handler. */
+void raise_softirq (u32_t nr);
+
+/* Whether softirqs are pending on this processor */
+int local_softirq_pending (void);
+
+/* Run the softirqs pending on this processor, unless they are
+ * running already. For the idle loop, with interrupts disabled. */
+void run_softirqs (void);
+
+/* Run the pending softirqs and preempt the interrupted task if it
+ * needs to be. Called by the irq entry stubs in irq.S after the PIC
+ * has been acknowledged. */
+void irq_exit (void);
+
+#endif /* __SOFTIRQ_H__ */
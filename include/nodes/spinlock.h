@@ -0,0 +1,268 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/spinlock.h
+ * Description:   Spin locks, reader writer locks and their statistics.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __SPINLOCK_H__
+#define __SPINLOCK_H__
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/sched.h>
+#include <asm/spinlock.h>
+#include <asm/interrupt.h>
+#include <asm/msr.h>
+
+
+/* A spin lock must not be held across anything that sleeps. Holding
+ * one disables preemption. A lock that is also taken by an interrupt
+ * handler must be taken with one of the _irq variants everywhere
+ * else, or the handler can spin forever on a lock its own processor
+ * holds.
+ *
+ * The raw_ variants leave preemption alone. They are for code that
+ * already runs with interrupts disabled and can not use the preempt
+ * count, like the scheduler, whose lock is held across a switch.
+ *
+ * On a uniprocessor build the locks themselves compile away. What is
+ * left is the preempt count and the interrupt flag handling.
+ *
+ * With CONFIG_LOCK_STAT every spin lock counts its acquisitions, how
+ * many of them had to wait, the cycles spent waiting and the average
+ * and longest time it was held. Mutexes keep the same numbers. A
+ * lock adds itself to the list printed by lock_stat_print the first
+ * time it is taken.
+ */
+
+#ifdef CONFIG_LOCK_STAT
+
+struct lock_stat {
+	const char *name;
+	u32_t acquisitions;
+	u32_t contended;          /* Acquisitions that had to wait */
+	u64_t wait_cycles;        /* Spent waiting, in total */
+	u64_t hold_cycles;        /* Spent holding it, in total */
+	u64_t max_hold_cycles;    /* The longest time it was held */
+	u64_t acquired_at;        /* rdtsc when it was last taken */
+	struct lock_stat *next;   /* On the list of locks taken so far */
+	u32_t registered;
+};
+
+#define LOCK_STAT_INIT(lockname) , { lockname, 0, 0, 0, 0, 0, 0, 0, 0 }
+
+/* Put `stat' on the list of locks lock_stat_print shows */
+void lock_stat_register (struct lock_stat *stat);
+
+/* Print the statistics of every lock taken so far */
+void lock_stat_print (void);
+
+#else
+
+#define LOCK_STAT_INIT(lockname)
+
+#endif /* CONFIG_LOCK_STAT */
+
+
+typedef struct {
+	arch_spinlock_t raw;
+#ifdef CONFIG_LOCK_STAT
+	struct lock_stat stat;
+#endif /* CONFIG_LOCK_STAT */
+} spinlock_t;
+
+typedef struct {
+	arch_rwlock_t raw;
+} rwlock_t;
+
+
+#define SPIN_LOCK_UNLOCKED(lockname)					\
+	{ ARCH_SPIN_LOCK_UNLOCKED LOCK_STAT_INIT (lockname) }
+
+#define RW_LOCK_UNLOCKED  { ARCH_RW_LOCK_UNLOCKED }
+
+#define DEFINE_SPINLOCK(x)  spinlock_t x = SPIN_LOCK_UNLOCKED (#x)
+#define DEFINE_RWLOCK(x)    rwlock_t x = RW_LOCK_UNLOCKED
+
+#define spin_lock_init(lock)  __spin_lock_init (lock, #lock)
+
+static inline void __spin_lock_init (spinlock_t *lock, const char *name)
+{
+	spinlock_t init = SPIN_LOCK_UNLOCKED (name);
+
+	*lock = init;
+}
+
+static inline void rwlock_init (rwlock_t *rw)
+{
+	rwlock_t init = RW_LOCK_UNLOCKED;
+
+	*rw = init;
+}
+
+
+#ifdef CONFIG_LOCK_STAT
+
+static inline void raw_spin_lock (spinlock_t *lock)
+{
+	u64_t start;
+
+	if (!arch_spin_trylock (&lock->raw)){
+		start = rdtsc();
+		arch_spin_lock (&lock->raw);
+		lock->stat.contended++;
+		lock->stat.wait_cycles += rdtsc() - start;
+	}
+
+	if (!lock->stat.registered) lock_stat_register (&lock->stat);
+
+	lock->stat.acquisitions++;
+	lock->stat.acquired_at = rdtsc();
+}
+
+static inline int raw_spin_trylock (spinlock_t *lock)
+{
+	if (!arch_spin_trylock (&lock->raw)) return 0;
+
+	if (!lock->stat.registered) lock_stat_register (&lock->stat);
+
+	lock->stat.acquisitions++;
+	lock->stat.acquired_at = rdtsc();
+
+	return 1;
+}
+
+static inline void raw_spin_unlock (spinlock_t *lock)
+{
+	u64_t held = rdtsc() - lock->stat.acquired_at;
+
+	lock->stat.hold_cycles += held;
+	if (held > lock->stat.max_hold_cycles)
+		lock->stat.max_hold_cycles = held;
+
+	arch_spin_unlock (&lock->raw);
+}
+
+#else
+
+#define raw_spin_lock(lock)     arch_spin_lock (&(lock)->raw)
+#define raw_spin_trylock(lock)  arch_spin_trylock (&(lock)->raw)
+#define raw_spin_unlock(lock)   arch_spin_unlock (&(lock)->raw)
+
+#endif /* CONFIG_LOCK_STAT */
+
+#define spin_is_locked(lock)    arch_spin_is_locked (&(lock)->raw)
+
+
+#define spin_lock(lock) do {						\
+	preempt_disable();						\
+	raw_spin_lock (lock);						\
+} while (0)
+
+#define spin_unlock(lock) do {						\
+	raw_spin_unlock (lock);						\
+	preempt_enable();						\
+} while (0)
+
+static inline int spin_trylock (spinlock_t *lock)
+{
+	preempt_disable();
+	if (raw_spin_trylock (lock)) return 1;
+	preempt_enable();
+	return 0;
+}
+
+/* With interrupts disabled nothing can preempt us, the preempt count
+ * is left alone. */
+
+#define spin_lock_irq(lock) do {					\
+	cli();								\
+	raw_spin_lock (lock);						\
+} while (0)
+
+#define spin_unlock_irq(lock) do {					\
+	raw_spin_unlock (lock);						\
+	sti();								\
+} while (0)
+
+#define spin_lock_irqsave(lock, flags) do {				\
+	local_irq_save (flags);						\
+	raw_spin_lock (lock);						\
+} while (0)
+
+#define spin_unlock_irqrestore(lock, flags) do {			\
+	raw_spin_unlock (lock);						\
+	local_irq_restore (flags);					\
+} while (0)
+
+
+#define read_lock(rw) do {						\
+	preempt_disable();						\
+	arch_read_lock (&(rw)->raw);					\
+} while (0)
+
+#define read_unlock(rw) do {						\
+	arch_read_unlock (&(rw)->raw);					\
+	preempt_enable();						\
+} while (0)
+
+#define write_lock(rw) do {						\
+	preempt_disable();						\
+	arch_write_lock (&(rw)->raw);					\
+} while (0)
+
+#define write_unlock(rw) do {						\
+	arch_write_unlock (&(rw)->raw);					\
+	preempt_enable();						\
+} while (0)
+
+#define read_lock_irqsave(rw, flags) do {				\
+	local_irq_save (flags);						\
+	arch_read_lock (&(rw)->raw);					\
+} while (0)
+
+#define read_unlock_irqrestore(rw, flags) do {				\
+	arch_read_unlock (&(rw)->raw);					\
+	local_irq_restore (flags);					\
+} while (0)
+
+#define write_lock_irqsave(rw, flags) do {				\
+	local_irq_save (flags);						\
+	arch_write_lock (&(rw)->raw);					\
+} while (0)
+
+#define write_unlock_irqrestore(rw, flags) do {			\
+	arch_write_unlock (&(rw)->raw);					\
+	local_irq_restore (flags);					\
+} while (0)
+
+#endif /* __SPINLOCK_H__ */
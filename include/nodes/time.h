@@ -0,0 +1,115 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/time.h
+ * Description:   Kernel time keeping: jiffies and the nanosecond clock.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __TIME_H__
+#define __TIME_H__
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <asm/msr.h>
+#include <asm/div64.h>
+
+#define NSEC_PER_USEC 1000
+#define NSEC_PER_MSEC 1000000
+#define NSEC_PER_SEC  1000000000
+
+#define TICK_NSEC (NSEC_PER_SEC / HZ)  /* Length of a tick */
+
+
+/* Nanoseconds since the clock was started. Monotonic. */
+typedef u64_t ktime_t;
+
+
+extern volatile u32_t jiffies;  /* Ticks since the clock was started */
+
+extern u32_t tsc_khz;           /* Frequency of the time stamp
+				 * counter, 0 if it is not usable */
+
+/* The state of the time stamp counter clocksource. Read only after
+ * init_time. */
+extern u64_t tsc_base;
+extern u32_t tsc_mult;
+extern u32_t tsc_shift;
+
+
+/* Returns the monotonic time in nanoseconds. With a usable TSC this is
+ * an rdtsc and two multiplies. Without one it falls back to tick
+ * resolution. */
+
+static inline ktime_t ktime_get (void)
+{
+	if (tsc_khz)
+		return mul_u64_u32_shr (rdtsc() - tsc_base, tsc_mult, tsc_shift);
+
+	return (u64_t) jiffies * TICK_NSEC;
+}
+
+/* Convert a number of TSC cycles to nanoseconds */
+static inline u64_t cycles_to_ns (u64_t cycles)
+{
+	return mul_u64_u32_shr (cycles, tsc_mult, tsc_shift);
+}
+
+
+/* A device that delivers the timer tick. It normally interrupts every
+ * TICK_NSEC. The idle loop may switch it to a single interrupt some
+ * time ahead when nothing needs the tick (see kernel/idle.c).
+ */
+
+struct clock_event {
+	const char *name;
+	u64_t max_delta_ns;   /* The furthest ahead set_next_event
+			       * can reach */
+
+	void (*set_periodic) (void);            /* Tick every TICK_NSEC */
+	void (*set_next_event) (u64_t delta_ns); /* One interrupt in
+						  * delta_ns, then quiet */
+};
+
+extern struct clock_event *tick_device;  /* The device that drives
+					  * the tick */
+
+
+/* Bring jiffies up to date with ktime_get. Interrupts must be
+ * disabled. */
+void update_jiffies (void);
+
+/* Busy wait for `usecs' microseconds */
+void udelay (u32_t usecs);
+
+/* Calibrate the clocks and start the timer tick */
+void init_time (void);
+
+#endif /* __TIME_H__ */
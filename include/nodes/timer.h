@@ -0,0 +1,102 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/timer.h
+ * Description:   Kernel timers.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include <sys/types.h>
+#include <nodes/list.h>
+
+
+/* A kernel timer. The storage belongs to the caller. Set `expires',
+ * `function' and `data' and pass it to add_timer. `function' runs
+ * from the timer softirq, with interrupts enabled, once jiffies has
+ * reached `expires'.
+ */
+
+struct timer_list {
+	struct list_head entry;     /* Links the timer into the wheel */
+	u32_t expires;              /* In jiffies */
+
+	void (*function) (void *data);
+	void *data;
+};
+
+
+/* Compare jiffies values correctly across the wrap around */
+
+#define time_after(a, b)     ((s32_t) ((b) - (a)) < 0)
+#define time_before(a, b)    time_after (b, a)
+#define time_after_eq(a, b)  ((s32_t) ((a) - (b)) >= 0)
+
+
+static inline void init_timer (struct timer_list *timer)
+{
+	timer->entry.next = 0;
+}
+
+/* Returns true if `timer' is armed */
+static inline int timer_pending (const struct timer_list *timer)
+{
+	return timer->entry.next != 0;
+}
+
+
+/* Arm `timer'. It must not be armed already. */
+void add_timer (struct timer_list *timer);
+
+/* Disarm `timer' if it is armed, then arm it for `expires' */
+void mod_timer (struct timer_list *timer, u32_t expires);
+
+/* Disarm `timer'. Returns 1 if it was armed, 0 otherwise. */
+int del_timer (struct timer_list *timer);
+
+#define NEXT_TIMER_MAX_DELTA ((1UL << 30) - 1)
+
+/* Returns the jiffy at which the next timer expires. Interrupts must
+ * be disabled. */
+u32_t next_timer_interrupt (void);
+
+/* Called from the timer tick. Schedules the expiry of due timers. */
+void run_local_timers (void);
+
+/* Initialize the timer wheel */
+void init_timers (void);
+
+/* Arm and cancel a large number of timers and compare against a
+ * sorted list. */
+void bench_timers (void);
+
+#endif /* __TIMER_H__ */
@@ -0,0 +1,104 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/trace.h
+ * Description:   Static tracepoints.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <sys/types.h>
+#include <nodes/config.h>
+
+
+/* A tracepoint writes a fixed size binary record into a ring of the
+ * processor it runs on. Nothing is formatted until the rings are
+ * dumped, so a tracepoint costs about as much as an rdtsc, and
+ * nothing at all when tracing is off. Without CONFIG_TRACE the
+ * tracepoints are not compiled in.
+ *
+ * tools/tracedump.c decodes a dump and knows the layout of the record
+ * and the events below, so change them together.
+ */
+
+#define TRACE_IRQ_ENTRY    1   /* irq */
+#define TRACE_IRQ_EXIT     2   /* irq, what the handler returned */
+#define TRACE_PAGE_ALLOC   3   /* zone, page */
+#define TRACE_PAGE_FREE    4   /* page */
+#define TRACE_KB_SCAN      5   /* scan code */
+
+struct trace_record {
+	u64_t stamp;     /* Time stamp counter */
+	u16_t event;
+	u8_t cpu;
+	u8_t pad;
+	u32_t arg[3];
+};
+
+
+#ifdef CONFIG_TRACE
+
+extern volatile u32_t trace_enabled;
+
+void __trace (u32_t event, u32_t a0, u32_t a1, u32_t a2);
+
+#define trace(event, a0, a1, a2) do {					\
+	if (trace_enabled) __trace (event, a0, a1, a2);			\
+} while (0)
+
+/* Start and stop recording. The rings keep the latest events. */
+void trace_start (void);
+void trace_stop (void);
+
+/* Write the rings out on the serial port and start them again empty.
+ * Sleeps, so it must not be called from an interrupt handler. */
+void trace_dump (void);
+
+/* Have the tracedump thread call trace_dump */
+void trace_request_dump (void);
+
+/* Start the tracedump thread */
+void init_trace (void);
+
+#else
+
+#define trace(event, a0, a1, a2)  do { } while (0)
+
+static inline void trace_start (void) { }
+static inline void trace_stop (void) { }
+static inline void trace_dump (void) { }
+static inline void trace_request_dump (void) { }
+static inline void init_trace (void) { }
+
+#endif /* CONFIG_TRACE */
+
+#endif /* __TRACE_H__ */
@@ -0,0 +1,116 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     include/nodes/wait.h
+ * Description:   Wait queues.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#ifndef __WAIT_H__
+#define __WAIT_H__
+
+#include <sys/types.h>
+#include <nodes/list.h>
+#include <nodes/sched.h>
+#include <nodes/spinlock.h>
+
+
+/* A wait queue is a list of tasks sleeping until something happens.
+ * Whoever makes it happen changes the condition the sleepers test
+ * and calls wake_up, which may be done from an interrupt handler.
+ *
+ * A sleeper adds itself and marks itself blocked before it tests the
+ * condition, so a wakeup that comes in between only makes its
+ * schedule return at once. See wait_event.
+ */
+
+struct wait_queue_head {
+	spinlock_t lock;
+	struct list_head task_list;
+};
+
+struct wait_queue {
+	struct task *task;
+	struct list_head entry;
+};
+
+
+#define WAIT_QUEUE_HEAD_INIT(name)					\
+	{ SPIN_LOCK_UNLOCKED (#name), LIST_HEAD_INIT ((name).task_list) }
+
+#define DECLARE_WAIT_QUEUE_HEAD(name)					\
+	struct wait_queue_head name = WAIT_QUEUE_HEAD_INIT (name)
+
+/* An entry for the current task, on its stack */
+#define DEFINE_WAIT(name)						\
+	struct wait_queue name = { current, LIST_HEAD_INIT ((name).entry) }
+
+
+void init_waitqueue_head (struct wait_queue_head *wq);
+
+/* Put `wait' on `wq', if it is not there yet, and mark the current
+ * task blocked */
+void prepare_to_wait (struct wait_queue_head *wq, struct wait_queue *wait);
+
+/* Mark the current task running and take `wait' off `wq' */
+void finish_wait (struct wait_queue_head *wq, struct wait_queue *wait);
+
+/* Wake every task sleeping on `wq' */
+void wake_up (struct wait_queue_head *wq);
+
+/* Wake the task that has slept on `wq' longest and take it off the
+ * queue. If what it waits for is gone again by the time it runs,
+ * wait_event puts it back at the end. Locks use this so a release
+ * wakes one waiter instead of all of them. */
+void wake_up_one (struct wait_queue_head *wq);
+
+/* Whether anyone sleeps on `wq'. A waker that looks at this without
+ * the lock needs a full barrier between making its condition true and
+ * the look; the matching one is in prepare_to_wait. */
+static inline int waitqueue_active (struct wait_queue_head *wq)
+{
+	return !list_empty (&wq->task_list);
+}
+
+
+/* Sleep on `wq' until `condition' is true. Must not be called with
+ * interrupts disabled or from an interrupt handler. */
+#define wait_event(wq, condition) do {					\
+	DEFINE_WAIT (__wait);						\
+									\
+	for (;;){							\
+		prepare_to_wait (&(wq), &__wait);			\
+		if (condition) break;					\
+		schedule();						\
+	}								\
+	finish_wait (&(wq), &__wait);					\
+} while (0)
+
+#endif /* __WAIT_H__ */
@@ -39,5 +39,11 @@
 typedef unsigned char u8_t;
 typedef unsigned short u16_t;
 typedef unsigned int u32_t;
+typedef unsigned long long u64_t;
+
+typedef signed char s8_t;
+typedef signed short s16_t;
+typedef signed int s32_t;
+typedef signed long long s64_t;
 
 #endif /* __TYPES_H__ */
@@ -0,0 +1,143 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/boot_phase.c
+ * Description:   How long the steps of booting take.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* A step of booting is stamped with the time stamp counter into a
+ * static table. That is all there is to it, so it costs nothing to
+ * leave in. The first steps run in init_mm before paging is on, when
+ * the table can only be reached through its physical address.
+ *
+ * The stamp of the first step is also the time spent before the
+ * kernel, in the firmware and the boot loader, as far as the time
+ * stamp counter started at reset.
+ */
+
+#include <sys/types.h>
+#include <nodes/boot_phase.h>
+#include <nodes/time.h>
+#include <nodes/log.h>
+#include <asm/mm.h>
+#include <asm/msr.h>
+#include <asm/div64.h>
+#include <mm/mm.h>
+
+
+#define BOOT_PHASES  32
+
+struct boot_phase {
+	const char *name;
+	u64_t stamp;
+};
+
+static struct boot_phases {
+	u32_t nr;
+	struct boot_phase phase[BOOT_PHASES];
+} boot_phases;
+
+
+void boot_phase (const char *name)
+{
+	struct boot_phases *b = &boot_phases;
+
+	if ( !(read_cr0() & CR0_PG))
+		b = (struct boot_phases *) phys_addr ( (u32_t) b);
+
+	if (b->nr == BOOT_PHASES) return;
+
+	b->phase[b->nr].name = name;
+	b->phase[b->nr].stamp = rdtsc();
+	b->nr++;
+}
+
+
+/* Microseconds in `cycles', or the cycles without a TSC rate */
+
+static u32_t phase_us (u64_t cycles)
+{
+	u64_t ns;
+
+	if (!tsc_khz) return (u32_t) cycles;
+
+	ns = cycles_to_ns (cycles);
+	do_div (&ns, NSEC_PER_USEC);
+
+	return (u32_t) ns;
+}
+
+
+/* `part' of `whole' in tenths of a percent */
+
+static u32_t permille (u64_t part, u64_t whole)
+{
+	/* do_div only takes a 32 bit divisor */
+	while (whole >> 32){
+		part >>= 1;
+		whole >>= 1;
+	}
+
+	if (!whole) return 0;
+
+	part *= 1000;
+	do_div (&part, (u32_t) whole);
+
+	return (u32_t) part;
+}
+
+
+void boot_phases_print (void)
+{
+	u64_t now = rdtsc(), total, cycles;
+	u32_t i, pct;
+
+	if (!boot_phases.nr) return;
+
+	total = now - boot_phases.phase[0].stamp;
+
+	printk (LOG_INFO, "Boot phases, in %s:\n", tsc_khz ? "us" : "cycles");
+	printk (LOG_INFO, "  %-24s %10u\n", "before the kernel",
+		phase_us (boot_phases.phase[0].stamp));
+
+	for (i = 0; i < boot_phases.nr; i++){
+		cycles = (i + 1 < boot_phases.nr ? boot_phases.phase[i + 1].stamp
+			  : now) - boot_phases.phase[i].stamp;
+
+		pct = permille (cycles, total);
+
+		printk (LOG_INFO, "  %-24s %10u %3u.%u%%\n",
+			boot_phases.phase[i].name, phase_us (cycles),
+			pct / 10, pct % 10);
+	}
+
+	printk (LOG_INFO, "  %-24s %10u\n", "total", phase_us (total));
+}
@@ -0,0 +1,335 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/callgraph.c
+ * Description:   Call graphs from -finstrument-functions.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* gcc calls __cyg_profile_func_enter and __cyg_profile_func_exit
+ * around the body of every function in a file built with
+ * -finstrument-functions. The Makefile does that for the directories
+ * in INSTRUMENT, never for this file.
+ *
+ * Every processor keeps a stack of the functions it is in and a tree
+ * of the paths it took to get there, a calling context tree, so the
+ * same function called from two places shows up twice. A node counts
+ * the calls along its path, the cycles spent in them (inclusive) and
+ * those not spent in the functions they called (exclusive). The
+ * nodes are numbered rather than pointed to, because the first calls
+ * come from init_mm before paging is on, when the tables are reached
+ * through their physical addresses.
+ *
+ * The hooks run with interrupts off, so an interrupt never sees a
+ * half pushed frame. An interrupt that comes in the middle of a
+ * function simply nests under it, and its time is taken out of the
+ * exclusive time of that function. A task switch breaks the nesting
+ * though: the task switched to returns from functions it entered on
+ * its own stack. An exit that is not on top of the stack drops the
+ * frames above the one it matches, or is ignored if it matches none.
+ * Both are counted as lost.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/callgraph.h>
+#include <nodes/ksyms.h>
+#include <nodes/sched.h>
+#include <nodes/time.h>
+#include <nodes/log.h>
+#include <nodes/wait.h>
+#include <nodes/devices.h>
+#include <asm/interrupt.h>
+#include <asm/percpu.h>
+#include <asm/msr.h>
+#include <asm/div64.h>
+#include <asm/smp.h>
+#include <asm/mm.h>
+#include <mm/mm.h>
+#include <io.h>
+
+
+#ifdef CONFIG_INSTRUMENT
+
+#define __noinstr  __attribute__ ((no_instrument_function))
+
+#define CG_MAX_DEPTH  32
+#define CG_MAX_NODES  256
+#define CG_NONE       0xffffffff   /* A node when the table is full */
+
+struct cg_node {
+	u32_t fn;
+	u32_t parent, child, sibling;   /* Node numbers, 0 for none */
+	u32_t calls;
+	u64_t incl, excl;               /* Cycles */
+};
+
+struct cg_frame {
+	u32_t fn;
+	u32_t node;
+	u64_t start;
+	u64_t child;                    /* Cycles in the callees */
+};
+
+struct cg_cpu {
+	u32_t depth;
+	u32_t nr_nodes;
+	u32_t lost;
+	struct cg_frame stack[CG_MAX_DEPTH];
+	struct cg_node nodes[CG_MAX_NODES];   /* 0 is the root */
+} __attribute__ ((aligned (64)));
+
+static struct cg_cpu cg_cpus[NR_CPUS];
+
+
+/* The tables of this processor, or null if we can not tell which
+ * processor we are on yet. Where the stack is says nothing, as the
+ * stacks of the threads are identity mapped low memory too. */
+
+static inline __noinstr struct cg_cpu *cg_this_cpu (void)
+{
+	/* Only the boot processor runs before paging is on, and then
+	 * the tables are only reached through their physical address.
+	 * The others turn it on in the trampoline. */
+	if ( !(read_cr0() & CR0_PG))
+		return (struct cg_cpu *) phys_addr ( (u32_t) &cg_cpus[0]);
+
+	/* Until a processor has loaded its own per processor segment
+	 * it reads the template, where this is 0 */
+	if ( !this_cpu_read (this_cpu_off)) return 0;
+
+	return &cg_cpus[smp_processor_id()];
+}
+
+
+/* The child of node `parent' for function `fn', made if need be */
+
+static __noinstr u32_t cg_child (struct cg_cpu *c, u32_t parent, u32_t fn)
+{
+	struct cg_node *node;
+	u32_t n;
+
+	if (parent == CG_NONE) return CG_NONE;
+
+	if (!c->nr_nodes) c->nr_nodes = 1;
+
+	for (n = c->nodes[parent].child; n; n = c->nodes[n].sibling)
+		if (c->nodes[n].fn == fn) return n;
+
+	if (c->nr_nodes == CG_MAX_NODES){
+		c->lost++;
+		return CG_NONE;
+	}
+
+	n = c->nr_nodes++;
+	node = &c->nodes[n];
+
+	node->fn = fn;
+	node->parent = parent;
+	node->child = 0;
+	node->calls = 0;
+	node->incl = node->excl = 0;
+
+	/* Linked in last, for a reader walking the tree */
+	node->sibling = c->nodes[parent].child;
+	c->nodes[parent].child = n;
+
+	return n;
+}
+
+
+void __noinstr __cyg_profile_func_enter (void *this_fn, void *call_site)
+{
+	struct cg_cpu *c;
+	struct cg_frame *f;
+	u32_t flags, parent;
+
+	local_irq_save (flags);
+
+	c = cg_this_cpu();
+	if (!c) goto out;
+
+	if (c->depth >= CG_MAX_DEPTH){
+		c->lost++;
+		goto out;
+	}
+
+	parent = c->depth ? c->stack[c->depth - 1].node : 0;
+
+	f = &c->stack[c->depth];
+	f->fn = (u32_t) this_fn;
+	f->node = cg_child (c, parent, (u32_t) this_fn);
+	f->child = 0;
+	c->depth++;
+
+	/* Last, so the work above is charged to the caller */
+	f->start = rdtsc();
+
+ out:
+	local_irq_restore (flags);
+}
+
+
+void __noinstr __cyg_profile_func_exit (void *this_fn, void *call_site)
+{
+	u64_t now = rdtsc(), elapsed;
+	struct cg_cpu *c;
+	struct cg_frame *f;
+	struct cg_node *node;
+	u32_t flags, d;
+
+	local_irq_save (flags);
+
+	c = cg_this_cpu();
+	if (!c) goto out;
+
+	for (d = c->depth; d && c->stack[d - 1].fn != (u32_t) this_fn; d--);
+
+	if (!d){
+		c->lost++;
+		goto out;
+	}
+
+	c->lost += c->depth - d;
+	c->depth = d - 1;
+
+	f = &c->stack[d - 1];
+	elapsed = now - f->start;
+
+	if (f->node != CG_NONE){
+		node = &c->nodes[f->node];
+		node->calls++;
+		node->incl += elapsed;
+		node->excl += elapsed - f->child;
+	}
+
+	if (c->depth) c->stack[c->depth - 1].child += elapsed;
+
+ out:
+	local_irq_restore (flags);
+}
+
+
+static u32_t cycles_to_us (u64_t cycles)
+{
+	u64_t ns = cycles_to_ns (cycles);
+
+	do_div (&ns, NSEC_PER_USEC);
+	return (u32_t) ns;
+}
+
+
+/* Walk the tree depth first, callers before their callees. A tree
+ * is up to CG_MAX_NODES lines, more than the kernel log holds, so it
+ * goes straight out on the serial port like a trace dump. */
+
+static void cg_print_cpu (u32_t cpu)
+{
+	struct cg_cpu *c = &cg_cpus[cpu];
+	struct cg_node *node;
+	u32_t n, depth = 0;
+	char line[128];
+	int len;
+
+	len = snprintf (line, sizeof (line),
+			"Call graph of processor %u, %u nodes, %u lost\n",
+			cpu, c->nr_nodes ? c->nr_nodes - 1 : 0, c->lost);
+	serial_write (line, len);
+
+	if (c->nr_nodes < 2) return;
+
+	len = snprintf (line, sizeof (line),
+			"   calls    incl us    excl us  function\n");
+	serial_write (line, len);
+
+	n = c->nodes[0].child;
+
+	while (n){
+		node = &c->nodes[n];
+
+		len = snprintf (line, sizeof (line), "%8u %10u %10u  %*s%s\n",
+				node->calls, cycles_to_us (node->incl),
+				cycles_to_us (node->excl), 2 * depth, "",
+				ksym_name (ksym_lookup (node->fn)));
+		if (len >= sizeof (line)) len = sizeof (line) - 1;
+		serial_write (line, len);
+
+		if (node->child){
+			n = node->child;
+			depth++;
+			continue;
+		}
+
+		while (n && !c->nodes[n].sibling){
+			n = c->nodes[n].parent;
+			depth--;
+		}
+
+		if (n) n = c->nodes[n].sibling;
+	}
+}
+
+
+/* serial_write may sleep, so the report is written by a thread of
+ * its own */
+
+static DECLARE_WAIT_QUEUE_HEAD (cg_print_wait);
+static volatile u32_t cg_print_requested;
+
+
+void callgraph_print (void)
+{
+	cg_print_requested = 1;
+	wake_up (&cg_print_wait);
+}
+
+
+static void cg_printer (void *arg)
+{
+	u32_t cpu;
+
+	for (;;){
+		wait_event (cg_print_wait, cg_print_requested);
+		cg_print_requested = 0;
+
+		for (cpu = 0; cpu < num_online_cpus; cpu++)
+			cg_print_cpu (cpu);
+
+		printk (LOG_INFO, "The call graph is out on the serial port\n");
+	}
+}
+
+
+void init_callgraph (void)
+{
+	kthread_create (cg_printer, 0, "callgraph");
+}
+
+#endif /* CONFIG_INSTRUMENT */
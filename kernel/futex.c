@@ -0,0 +1,338 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/futex.c
+ * Description:   Fast user space locking.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* Sleepers are kept in a table of FUTEX_HASH_SIZE buckets, hashed by
+ * the physical address of their word, the key. Each bucket has its
+ * own lock and a chain of the sleepers whose keys hash to it. A
+ * sleeper is described by a futex_q on its own stack.
+ *
+ * futex_wait compares the word under the lock of its bucket and
+ * queues itself before dropping it, and the wakers take the same
+ * lock. A waker that changed the word before looking for sleepers
+ * therefore either finds us queued or we see the new value.
+ *
+ * A waker takes the futex_q off the chain and wakes its task while it
+ * holds the bucket lock. An empty list entry tells the sleeper it
+ * was woken. A requeue moves a futex_q to another bucket, with both
+ * locks held, so a sleeper looks up its bucket again each time it
+ * locks it.
+ */
+
+#include <sys/types.h>
+#include <sys/errno.h>
+#include <nodes/list.h>
+#include <nodes/sched.h>
+#include <nodes/spinlock.h>
+#include <nodes/futex.h>
+#include <asm/mm.h>
+#include <asm/atomic.h>
+#include <io.h>
+
+
+#define FUTEX_HASH_BITS  8
+#define FUTEX_HASH_SIZE  (1 << FUTEX_HASH_BITS)
+
+struct futex_hash_bucket {
+	spinlock_t lock;
+	struct list_head chain;
+} __attribute__ ((aligned (64)));   /* A cache line each */
+
+struct futex_q {
+	struct list_head list;             /* On the chain of `bucket' */
+	struct task *task;
+	u32_t key;                         /* Physical address of the
+					    * word */
+	struct futex_hash_bucket *bucket;
+};
+
+static struct futex_hash_bucket futex_queues[FUTEX_HASH_SIZE];
+
+
+/* Words are 4 byte aligned, so the low bits say nothing */
+
+static struct futex_hash_bucket *hash_futex (u32_t key)
+{
+	return &futex_queues[ ( (key >> 2) * 0x9e3779b1) >> (32 - FUTEX_HASH_BITS)];
+}
+
+
+/* Lock the bucket `q' is on, which a requeue may change until we
+ * hold its lock */
+
+static struct futex_hash_bucket *lock_futex_q (struct futex_q *q)
+{
+	struct futex_hash_bucket *hb;
+
+	for (;;){
+		hb = q->bucket;
+		spin_lock (&hb->lock);
+		if (hb == q->bucket) return hb;
+		spin_unlock (&hb->lock);
+	}
+}
+
+
+/* Take the two buckets in address order so two requeues going in
+ * opposite directions do not deadlock */
+
+static void double_lock (struct futex_hash_bucket *hb1,
+			 struct futex_hash_bucket *hb2)
+{
+	if (hb1 > hb2){
+		struct futex_hash_bucket *t = hb1;
+
+		hb1 = hb2;
+		hb2 = t;
+	}
+
+	spin_lock (&hb1->lock);
+	if (hb1 != hb2) spin_lock (&hb2->lock);
+}
+
+static void double_unlock (struct futex_hash_bucket *hb1,
+			   struct futex_hash_bucket *hb2)
+{
+	spin_unlock (&hb1->lock);
+	if (hb1 != hb2) spin_unlock (&hb2->lock);
+}
+
+
+/* Dequeue and wake `q'. Its bucket lock is held. */
+
+static void wake_futex (struct futex_q *q)
+{
+	list_del_init (&q->list);
+	wake_up_task (q->task);
+}
+
+
+int futex_wait (u32_t *uaddr, u32_t val)
+{
+	struct futex_hash_bucket *hb;
+	struct futex_q q;
+
+	q.key = virt_to_phys ( (u32_t) uaddr);
+	if (!q.key || (q.key & 3)) return -EFAULT;
+
+	q.task = current;
+	q.bucket = hb = hash_futex (q.key);
+
+	spin_lock (&hb->lock);
+
+	if (*(volatile u32_t *) uaddr != val){
+		spin_unlock (&hb->lock);
+		return -EAGAIN;
+	}
+
+	list_add_tail (&q.list, &hb->chain);
+
+	for (;;){
+		current->state = TASK_BLOCKED;
+		spin_unlock (&hb->lock);
+
+		schedule();
+
+		hb = lock_futex_q (&q);
+		if (list_empty (&q.list)) break;
+	}
+
+	current->state = TASK_RUNNING;
+	spin_unlock (&hb->lock);
+
+	return 0;
+}
+
+
+int futex_wake (u32_t *uaddr, u32_t nr)
+{
+	struct futex_hash_bucket *hb;
+	struct list_head *pos, *n;
+	struct futex_q *q;
+	u32_t key;
+	int woken = 0;
+
+	key = virt_to_phys ( (u32_t) uaddr);
+	if (!key || (key & 3)) return -EFAULT;
+
+	hb = hash_futex (key);
+
+	spin_lock (&hb->lock);
+
+	list_for_each_safe (pos, n, &hb->chain){
+		if (woken >= nr) break;
+
+		q = list_entry (pos, struct futex_q, list);
+		if (q->key != key) continue;
+
+		wake_futex (q);
+		woken++;
+	}
+
+	spin_unlock (&hb->lock);
+
+	return woken;
+}
+
+
+int futex_requeue (u32_t *uaddr, u32_t nr_wake, u32_t nr_requeue,
+		   u32_t *uaddr2)
+{
+	struct futex_hash_bucket *hb1, *hb2;
+	struct list_head *pos, *n;
+	struct futex_q *q;
+	u32_t key1, key2;
+	int woken = 0, moved = 0;
+
+	key1 = virt_to_phys ( (u32_t) uaddr);
+	key2 = virt_to_phys ( (u32_t) uaddr2);
+	if (!key1 || (key1 & 3) || !key2 || (key2 & 3)) return -EFAULT;
+
+	hb1 = hash_futex (key1);
+	hb2 = hash_futex (key2);
+
+	double_lock (hb1, hb2);
+
+	list_for_each_safe (pos, n, &hb1->chain){
+		q = list_entry (pos, struct futex_q, list);
+		if (q->key != key1) continue;
+
+		if (woken < nr_wake){
+			wake_futex (q);
+			woken++;
+			continue;
+		}
+
+		if (moved >= nr_requeue) break;
+
+		q->key = key2;
+		if (hb1 != hb2){
+			list_del (&q->list);
+			list_add_tail (&q->list, &hb2->chain);
+			q->bucket = hb2;
+		}
+		moved++;
+	}
+
+	double_unlock (hb1, hb2);
+
+	return woken + moved;
+}
+
+
+int do_futex (u32_t *uaddr, u32_t op, u32_t val, u32_t val2, u32_t *uaddr2)
+{
+	switch (op){
+	case FUTEX_WAIT:
+		return futex_wait (uaddr, val);
+	case FUTEX_WAKE:
+		return futex_wake (uaddr, val);
+	case FUTEX_REQUEUE:
+		return futex_requeue (uaddr, val, val2, uaddr2);
+	}
+
+	return -EINVAL;
+}
+
+
+void init_futex (void)
+{
+	u32_t i;
+
+	for (i = 0; i < FUTEX_HASH_SIZE; i++){
+		spin_lock_init (&futex_queues[i].lock);
+		INIT_LIST_HEAD (&futex_queues[i].chain);
+	}
+}
+
+
+/* A boot time check of the three operations. FUTEX_TEST_WAITERS
+ * threads sleep on test_word, pinned to processor 0 with us, so all
+ * of them are asleep by the time schedule gives us the processor
+ * back. We are the idle task and must not sleep ourselves, so we only
+ * wake and requeue. */
+
+#define FUTEX_TEST_WAITERS  3
+
+static u32_t test_word, test_word2;
+static volatile u32_t test_woken;
+
+
+static void futex_waiter (void *arg)
+{
+	if (futex_wait (&test_word, 0) == 0) xadd (&test_woken, 1);
+}
+
+
+void test_futex (void)
+{
+	u32_t i, started = 0;
+
+	printf ("\nTesting futexes with %u sleepers :\n", FUTEX_TEST_WAITERS);
+
+	test_word = test_word2 = 0;
+	test_woken = 0;
+
+	for (i = 0; i < FUTEX_TEST_WAITERS; i++)
+		if (kthread_create_on_cpu (futex_waiter, 0, "futex_waiter", 0))
+			started++;
+
+	if (started != FUTEX_TEST_WAITERS){
+		printf ("  out of memory\n");
+		return;
+	}
+
+	schedule();
+
+	boot_check ("wait on a changed word",
+		    futex_wait (&test_word, 1), -EAGAIN);
+	boot_check ("wake on a word nobody sleeps on",
+		    futex_wake (&test_word2, 1), 0);
+	boot_check ("requeue, woken and moved",
+		    futex_requeue (&test_word, 1, FUTEX_TEST_WAITERS - 1,
+				   &test_word2), FUTEX_TEST_WAITERS);
+
+	schedule();
+
+	boot_check ("threads woken", test_woken, 1);
+	boot_check ("wake on the old word",
+		    futex_wake (&test_word, FUTEX_TEST_WAITERS), 0);
+	boot_check ("wake on the new word",
+		    futex_wake (&test_word2, FUTEX_TEST_WAITERS),
+		    FUTEX_TEST_WAITERS - 1);
+
+	schedule();
+
+	boot_check ("threads woken", test_woken, FUTEX_TEST_WAITERS);
+}
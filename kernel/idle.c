@@ -0,0 +1,147 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/idle.c
+ * Description:   The idle loop and the dynamic tick.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* When there is nothing to do, the processor halts until the next
+ * interrupt instead of spinning. Halting alone would still wake us HZ
+ * times a second for the tick. With CONFIG_NO_HZ the idle loop looks
+ * up the next timer that is due and, if that is more than a tick away,
+ * programs the tick device for a single interrupt at that time. An
+ * idle machine with no timers pending then takes an interrupt only as
+ * often as the tick device can be programmed to sleep.
+ *
+ * Any interrupt ends the idle period. Jiffies is caught up from the
+ * nanosecond clock and the periodic tick is restarted.
+ *
+ * Only processor 0 keeps time and runs the timers, so only it stops
+ * its tick. The others keep ticking while idle, the tick is what
+ * wakes them to look for work offered by busy processors.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/time.h>
+#include <nodes/timer.h>
+#include <nodes/sched.h>
+#include <nodes/softirq.h>
+#include <asm/interrupt.h>
+#include <asm/percpu.h>
+
+
+/* Number of times the idle loop woke up */
+DEFINE_PER_CPU (u32_t, idle_wakeups);
+
+/* Set while the tick is in one shot mode */
+static DEFINE_PER_CPU (u32_t, tick_stopped);
+
+
+#ifdef CONFIG_NO_HZ
+
+/* Stop the periodic tick if the next timer is more than a tick away.
+ * Interrupts must be disabled. */
+
+static void tick_nohz_idle_enter (void)
+{
+	u32_t delta;
+	u64_t delta_ns;
+
+	if (!tsc_khz || !tick_device) return;
+
+	update_jiffies();
+
+	delta = next_timer_interrupt() - jiffies;
+	if ( (s32_t) delta <= 1) return;
+
+	delta_ns = (u64_t) delta * TICK_NSEC;
+	if (delta_ns > tick_device->max_delta_ns)
+		delta_ns = tick_device->max_delta_ns;
+
+	tick_device->set_next_event (delta_ns);
+	this_cpu_write (tick_stopped, 1);
+}
+
+#endif /* CONFIG_NO_HZ */
+
+
+/* Restart the periodic tick after an idle period. Interrupts must be
+ * disabled. */
+
+static void tick_nohz_idle_exit (void)
+{
+	if (!this_cpu_read (tick_stopped)) return;
+
+	this_cpu_write (tick_stopped, 0);
+	update_jiffies();
+	tick_device->set_periodic();
+}
+
+
+/* The idle loop. Called at the end of boot and never returns. This is
+ * the idle task, so it runs whenever no other task can. The run queue
+ * is checked with interrupts disabled, so a wakeup from an interrupt
+ * can not get lost between the check and the hlt. */
+
+void cpu_idle (void)
+{
+	for (;;){
+		cli();
+
+		if (need_resched() || sched_work_available()){
+			schedule();
+			sti();
+			continue;
+		}
+
+		/* Raised outside an interrupt, klogd's wakeup among
+		 * them. Checked with interrupts off, so nothing new
+		 * can be raised before the hlt. */
+		if (local_softirq_pending()){
+			run_softirqs();
+			sti();
+			continue;
+		}
+
+#ifdef CONFIG_NO_HZ
+		if (smp_processor_id() == 0)
+			tick_nohz_idle_enter();
+#endif /* CONFIG_NO_HZ */
+
+		safe_halt();
+
+		cli();
+		this_cpu_inc (idle_wakeups);
+		tick_nohz_idle_exit();
+		sti();
+	}
+}
@@ -0,0 +1,167 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/ksyms.c
+ * Description:   The names of the functions of the kernel.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* The symbol table is read once into a table of the functions in
+ * .text, sorted by address, so a lookup is a binary search. The
+ * names stay where the boot loader put them. The boot loader put
+ * them in the lower memory zone, which is identity mapped, and
+ * init_mm kept the page allocator off them.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/ksyms.h>
+#include <nodes/log.h>
+#include <mm/mm.h>
+#include <multiboot.h>
+#include <elf.h>
+
+
+#ifdef CONFIG_KSYMS
+
+extern char __text_begin[], __text_end[];
+
+struct ksym {
+	u32_t addr;
+	const char *name;
+};
+
+static struct ksym ksyms[KSYM_MAX];
+static u32_t nr_ksyms;
+
+
+/* Add the functions of the symbol table `symtab' with its strings in
+ * `strtab' to ksyms, keeping it sorted */
+
+static void ksyms_add (elf32_shdr_t *symtab, elf32_shdr_t *strtab)
+{
+	elf32_sym_t *sym = (elf32_sym_t *) symtab->sh_addr;
+	u32_t n = symtab->sh_size / sizeof (elf32_sym_t);
+	u32_t i, j;
+
+	for (; n; n--, sym++){
+		if (ELF32_ST_TYPE (sym->st_info) != STT_FUNC ||
+		    sym->st_value < (u32_t) __text_begin ||
+		    sym->st_value >= (u32_t) __text_end ||
+		    sym->st_name >= strtab->sh_size)
+			continue;
+
+		if (nr_ksyms == KSYM_MAX){
+			printk (LOG_WARNING, "ksyms: more than %u functions\n",
+				KSYM_MAX);
+			return;
+		}
+
+		/* It is done once, so an insertion sort will do */
+		for (i = nr_ksyms; i && ksyms[i - 1].addr > sym->st_value; i--);
+
+		if (i && ksyms[i - 1].addr == sym->st_value) continue;
+
+		for (j = nr_ksyms; j > i; j--) ksyms[j] = ksyms[j - 1];
+
+		ksyms[i].addr = sym->st_value;
+		ksyms[i].name = (const char *) strtab->sh_addr + sym->st_name;
+		nr_ksyms++;
+	}
+}
+
+
+void init_ksyms (void)
+{
+	multiboot_info_t *mbi = _mbi;
+	elf32_shdr_t *sh, *strtab;
+	u32_t i;
+
+	if ( !mbi || !is_bit_set (mbi->flags, MULTIBOOT_INFO_ELF_SHDR)){
+		printk (LOG_WARNING, "ksyms: no section headers from the boot loader\n");
+		return;
+	}
+
+	for (i = 0; i < mbi->u.elf_sec.num; i++){
+		sh = (elf32_shdr_t *) (mbi->u.elf_sec.addr + i * mbi->u.elf_sec.size);
+
+		if (sh->sh_type != SHT_SYMTAB || sh->sh_link >= mbi->u.elf_sec.num)
+			continue;
+
+		strtab = (elf32_shdr_t *) (mbi->u.elf_sec.addr +
+					   sh->sh_link * mbi->u.elf_sec.size);
+
+		if ( !sh->sh_addr || !strtab->sh_addr ||
+		     sh->sh_addr + sh->sh_size > LOW_MEM_BOUNDARY ||
+		     strtab->sh_addr + strtab->sh_size > LOW_MEM_BOUNDARY){
+			printk (LOG_WARNING, "ksyms: the symbol table was not loaded "
+				"where we can read it\n");
+			return;
+		}
+
+		ksyms_add (sh, strtab);
+	}
+
+	printk (LOG_INFO, "%u kernel functions\n", nr_ksyms);
+}
+
+
+u32_t ksym_lookup (u32_t addr)
+{
+	u32_t lo = 0, hi = nr_ksyms, mid;
+
+	if (addr < (u32_t) __text_begin || addr >= (u32_t) __text_end ||
+	    !nr_ksyms || addr < ksyms[0].addr)
+		return KSYM_NONE;
+
+	/* The last function at or below addr */
+	while (hi - lo > 1){
+		mid = (lo + hi) / 2;
+
+		if (ksyms[mid].addr <= addr) lo = mid;
+		else hi = mid;
+	}
+
+	return lo;
+}
+
+
+const char *ksym_name (u32_t n)
+{
+	return n < nr_ksyms ? ksyms[n].name : "(unknown)";
+}
+
+
+u32_t ksym_count (void)
+{
+	return nr_ksyms;
+}
+
+#endif /* CONFIG_KSYMS */
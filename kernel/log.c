@@ -0,0 +1,356 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/log.c
+ * Description:   A lock free kernel log
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* The log is a ring of LOG_RECORDS fixed size records. A writer takes
+ * the next sequence number with an xadd on log_head, which also gives
+ * it slot seq % LOG_RECORDS all to itself. It first marks the record
+ * in the slot as not ready, then fills it in and at last publishes it
+ * by storing its sequence number in rec->seq. Writers on different
+ * processors, or interrupted by one another, each fill in their own
+ * slot and never wait for each other.
+ *
+ * A reader wants record `pos' and finds it in slot pos % LOG_RECORDS
+ * once rec->seq == pos. If log_head is more than LOG_RECORDS ahead of
+ * pos the record has been overwritten and the reader moves on to the
+ * oldest one still there. Since a writer may overwrite the slot while
+ * the reader copies it, the reader checks rec->seq again afterwards,
+ * the way a seqlock is read.
+ *
+ * The only thing this can not cope with is a writer that is so slow
+ * that all of the ring is written over while it fills in its record.
+ *
+ * A writer then raises LOG_SOFTIRQ, which wakes klogd once the
+ * interrupt is over, or, for a writer that is not in an interrupt,
+ * at the next interrupt or when its processor goes idle, whichever
+ * comes first. klogd writes the new records out to every sink.
+ */
+
+#include <sys/types.h>
+#include <stdarg.h>
+#include <nodes/log.h>
+#include <nodes/softirq.h>
+#include <nodes/sched.h>
+#include <nodes/wait.h>
+#include <nodes/spinlock.h>
+#include <nodes/time.h>
+#include <asm/atomic.h>
+#include <asm/interrupt.h>
+#include <asm/div64.h>
+#include <io.h>
+
+
+#define LOG_RECORDS    256   /* A power of two */
+
+#define LOG_LINE_SIZE  (LOG_TEXT_SIZE + 32)   /* Text and prefix */
+
+static struct log_record log_ring[LOG_RECORDS];
+
+/* The next sequence number. They start at 1, as in the ring as it
+ * is at boot every record claims to be number 0. */
+static volatile u32_t log_head = 1;
+
+static struct log_sink *log_sinks;
+static DEFINE_SPINLOCK (log_sink_lock);
+
+static volatile u32_t log_draining;   /* Someone is in log_flush */
+static volatile u32_t log_sync;       /* Write out in printk */
+
+static struct task *klogd_task;
+static DECLARE_WAIT_QUEUE_HEAD (klogd_wait);
+
+
+int vprintk (u32_t level, const char *format, va_list ap)
+{
+	struct log_record *rec;
+	u32_t seq, flags;
+	int len;
+
+	seq = xadd (&log_head, 1);
+	rec = &log_ring[seq & (LOG_RECORDS - 1)];
+
+	/* Any number but seq and seq - LOG_RECORDS would do */
+	rec->seq = seq - 1;
+	wmb();
+
+	len = vsnprintf (rec->text, LOG_TEXT_SIZE, format, ap);
+	if (len >= LOG_TEXT_SIZE) len = LOG_TEXT_SIZE - 1;
+
+	rec->len = len;
+	rec->level = level;
+	rec->cpu = smp_processor_id();
+	rec->stamp = ktime_get();
+
+	store_release (&rec->seq, seq);
+
+	if (!klogd_task || log_sync){
+		log_flush();
+		return len;
+	}
+
+	local_irq_save (flags);
+	raise_softirq (LOG_SOFTIRQ);
+	local_irq_restore (flags);
+
+	return len;
+}
+
+
+int printk (u32_t level, const char *format, ...)
+{
+	va_list ap;
+	int ret;
+
+	va_start (ap, format);
+	ret = vprintk (level, format, ap);
+	va_end (ap);
+
+	return ret;
+}
+
+
+u32_t log_next_seq (void)
+{
+	return log_head;
+}
+
+u32_t log_first_seq (void)
+{
+	u32_t head = log_head;
+
+	return head > LOG_RECORDS + 1 ? head - LOG_RECORDS : 1;
+}
+
+
+/* There is no memcpy, and a structure assignment might want one */
+
+static void copy_record (struct log_record *to, struct log_record *from)
+{
+	u32_t *d = (u32_t *) to, *s = (u32_t *) from;
+	u32_t i;
+
+	for (i = 0; i < sizeof (*to) / sizeof (u32_t); i++) d[i] = s[i];
+}
+
+
+int log_read (u32_t *seq, struct log_record *rec)
+{
+	struct log_record *r;
+	u32_t pos = *seq;
+
+	for (;;){
+		if (log_head - pos > LOG_RECORDS) pos = log_head - LOG_RECORDS;
+		if (pos == log_head) return 0;
+
+		r = &log_ring[pos & (LOG_RECORDS - 1)];
+
+		if (load_acquire (&r->seq) != pos){
+			/* Either still being written or just overwritten */
+			if (log_head - pos > LOG_RECORDS) continue;
+			return 0;
+		}
+
+		copy_record (rec, r);
+		rmb();
+
+		if (r->seq == pos) break;
+	}
+
+	rec->seq = pos;
+	*seq = pos + 1;
+
+	return 1;
+}
+
+
+/* Is there anything record `seq' on for a reader to read? */
+
+static int log_ready (u32_t seq)
+{
+	if (seq == log_head) return 0;
+	if (log_head - seq > LOG_RECORDS) return 1;
+
+	return log_ring[seq & (LOG_RECORDS - 1)].seq == seq;
+}
+
+
+/* Put `rec' in `line' the way it is written out, with the time in
+ * seconds in front unless it carries on from the record before. */
+
+static u32_t format_record (char *line, const struct log_record *rec,
+			    int midline)
+{
+	u64_t sec = rec->stamp;
+	u32_t ns;
+	int n;
+
+	if (midline)
+		n = snprintf (line, LOG_LINE_SIZE, "%.*s", rec->len, rec->text);
+	else{
+		ns = do_div (&sec, NSEC_PER_SEC);
+		n = snprintf (line, LOG_LINE_SIZE, "[%5u.%06u] %.*s",
+			      (u32_t) sec, ns / NSEC_PER_USEC,
+			      rec->len, rec->text);
+	}
+
+	return n < LOG_LINE_SIZE ? n : LOG_LINE_SIZE - 1;
+}
+
+
+static void flush_sink (struct log_sink *sink)
+{
+	static char line[LOG_LINE_SIZE];   /* Under log_draining */
+	struct log_record rec;
+	u32_t want, n;
+
+	for (;;){
+		want = sink->seq;
+		if (!log_read (&sink->seq, &rec)) break;
+
+		if (rec.seq != want){
+			n = snprintf (line, LOG_LINE_SIZE,
+				      "%s[%u messages lost]\n",
+				      sink->midline ? "\n" : "", rec.seq - want);
+			sink->write (line, n);
+			sink->midline = 0;
+		}
+
+		if (rec.level > sink->level) continue;
+
+		n = format_record (line, &rec, sink->midline);
+		sink->write (line, n);
+
+		sink->midline = rec.len && rec.text[rec.len - 1] != '\n';
+	}
+}
+
+
+void log_flush (void)
+{
+	struct log_sink *sink;
+
+	/* Whoever is at it will see our records too, unless the system
+	 * is dying, when it may never get to them. */
+	if (xchg (&log_draining, 1) && !log_sync) return;
+
+	for (sink = log_sinks; sink; sink = sink->next) flush_sink (sink);
+
+	store_release (&log_draining, 0);
+}
+
+
+void log_panic (void)
+{
+	log_sync = 1;
+	log_flush();
+}
+
+
+void register_log_sink (struct log_sink *sink)
+{
+	u32_t flags;
+
+	sink->seq = log_first_seq();
+	sink->midline = 0;
+
+	/* Sinks are never taken off, so log_flush walks the list
+	 * without the lock */
+	spin_lock_irqsave (&log_sink_lock, flags);
+	sink->next = log_sinks;
+	store_release (&log_sinks, sink);
+	spin_unlock_irqrestore (&log_sink_lock, flags);
+
+	if (!klogd_task) log_flush();
+}
+
+
+static int log_pending (void)
+{
+	struct log_sink *sink;
+
+	for (sink = log_sinks; sink; sink = sink->next)
+		if (log_ready (sink->seq)) return 1;
+
+	return 0;
+}
+
+
+static void klogd (void *arg)
+{
+	for (;;){
+		wait_event (klogd_wait, log_pending());
+
+		if (log_draining) yield();
+		else log_flush();
+	}
+}
+
+
+/* The records were published with plain stores. The mb keeps the
+ * look at the queue behind them, against the one in prepare_to_wait,
+ * so klogd either is seen queued or sees the records. */
+
+static void log_softirq (void)
+{
+	mb();
+
+	if (waitqueue_active (&klogd_wait)) wake_up (&klogd_wait);
+}
+
+
+void dmesg (void)
+{
+	static char line[LOG_LINE_SIZE];
+	struct log_record rec;
+	u32_t seq = log_first_seq(), flags, n;
+	int midline = 0;
+
+	flags = console_begin();
+
+	while (log_read (&seq, &rec)){
+		n = format_record (line, &rec, midline);
+		console_write (line, n);
+		midline = rec.len && rec.text[rec.len - 1] != '\n';
+	}
+
+	console_end (flags);
+}
+
+
+void init_log (void)
+{
+	open_softirq (LOG_SOFTIRQ, log_softirq);
+
+	klogd_task = kthread_create (klogd, 0, "klogd");
+}
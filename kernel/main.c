@@ -40,6 +40,21 @@
 #include <io.h>
 #include <nodes/devices.h>
 #include <multiboot.h>
+#include <nodes/time.h>
+#include <nodes/timer.h>
+#include <nodes/config.h>
+#include <nodes/sched.h>
+#include <asm/smp.h>
+#include <asm/percpu.h>
+#include <nodes/spinlock.h>
+#include <nodes/tty.h>
+#include <nodes/futex.h>
+#include <nodes/log.h>
+#include <nodes/trace.h>
+#include <nodes/profile.h>
+#include <nodes/ksyms.h>
+#include <nodes/callgraph.h>
+#include <nodes/boot_phase.h>
 
 
 /* At this point we are in protected mode. We have an IDT with bogus
@@ -51,15 +66,29 @@
  */
 
 
-/* This is a structure describing the screen we will be using.
- * 
- * Note <17/12/2003>: This is cheap since all we can do at this stage
- * is read from the keyboard and write to the screen! In the future,
- * we must cater for proper terminals.
- */
+/* Echo what is typed on the console `arg'. Sleeps in tty_read while
+ * there is nothing. With CONFIG_BENCH every Enter also prints how long
+ * the keys took from the keyboard interrupt to here. */
 
-
-screen scr;
+static void tty_echo (void *arg)
+{
+	u32_t console = (u32_t) arg;
+	char buf[16];
+	u32_t n;
+#ifdef CONFIG_BENCH
+	u32_t i;
+#endif /* CONFIG_BENCH */
+
+	for (;;){
+		n = tty_read (console, buf, sizeof (buf));
+
+		vc_write (console, buf, n);
+#ifdef CONFIG_BENCH
+		for (i = 0; i < n; i++)
+			if (buf[i] == '\r') tty_latency_print();
+#endif /* CONFIG_BENCH */
+	}
+}
 
 /* The function that starts the ball rolling. 
  *
@@ -78,30 +107,106 @@ screen scr;
 void test_page_alloc (void); /* A temporary function to test the page
 			      * allocator */
 
+void test_futex (void);      /* Boot time checks of the futexes and */
+void test_semaphore (void);  /* the semaphores and completions */
+
 
 
 void kstart() 
 {
+	u32_t i;
+
+	boot_phase ("kstart");
+
+	setup_per_cpu_areas(); /* Must come before anything that uses
+				* per processor variables */
 
 	init_screen(25, 80, 7); /* Initialize the screen */
 
-	printf ("Welcome to Nodes\n\n");
+	serial_init(); /* Polled output on the serial port */
+
+#ifdef CONFIG_FBCON
+	init_fbcon(); /* High resolution console if we can have one */
+#endif /* CONFIG_FBCON */
+
+	init_ksyms(); /* The names of the functions, for the profilers */
+
+	printk (LOG_INFO, "Welcome to Nodes\n");
+
+	boot_phase ("init_sched");
+
+	init_sched(); /* From here on we are the idle task */
+
+	init_log(); /* Start klogd, which writes the kernel log out */
+
+	init_trace(); /* Start the thread that dumps the trace */
+	trace_start();
+
+	init_profile(); /* Start sampling where the time goes */
 
-	printf("Enabling Interrupts..");
+	init_callgraph(); /* Start the thread that prints the call graph */
+
+	boot_phase ("init_interrupts");
+
+	printk (LOG_INFO, "Enabling Interrupts..");
 	init_interrupts(); /* Setup the interrupt handling system and
 			    * enable interrupts.
 			    */
 
-	printf("done\n");
+	printk (LOG_INFO, "done\n");
+
+	boot_phase ("init_time");
+
+	init_timers(); /* Initialize the timer wheel */
+
+	init_futex(); /* Initialize the futex hash table */
+
+	init_time(); /* Calibrate the clocks and start the timer
+		      * tick */
+
+	boot_phase ("smp_init");
+
+	smp_init(); /* Start the other processors */
 
-	printf("Detected PS/2 Keyboard.\n");
-	printf ("Initializing Keyboard..");
+	printk (LOG_INFO, "Detected PS/2 Keyboard.\n");
+	printk (LOG_INFO, "Initializing Keyboard..");
+
+	boot_phase ("init_tty");
+
+	init_tty(); /* The input queues of the consoles */
+
+	boot_phase ("kb_init");
 
 	kb_init(); /* Initialize the keyboard. */
 
-	printf("done\n");
+	boot_phase ("serial_init_irq");
+
+	serial_init_irq(); /* Interrupt driven serial port */
+
+	for (i = 0; i < NR_CONSOLES; i++)
+		kthread_create (tty_echo, (void *) i, "tty_echo");
+
+	printk (LOG_INFO, "done\n");
+
+	boot_phases_print(); /* How long all of the above took */
 
 	test_page_alloc();
+	test_futex();
+	test_semaphore();
+
+#ifdef CONFIG_BENCH
+	bench_timers();
+	bench_sched();
+	bench_page_alloc();
+	bench_printf();
+#endif /* CONFIG_BENCH */
+
+#ifdef CONFIG_LOCK_STAT
+	lock_stat_print();
+#endif /* CONFIG_LOCK_STAT */
+
+	profile_print();
+	callgraph_print();
 
 	printf ("\nYou may begin testing the keyboard now.\n");
 
@@ -0,0 +1,163 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/mutex.c
+ * Description:   Sleeping locks that spin while their owner runs.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/sched.h>
+#include <nodes/spinlock.h>
+#include <nodes/wait.h>
+#include <nodes/mutex.h>
+#include <asm/atomic.h>
+#include <asm/msr.h>
+
+
+void __mutex_init (struct mutex *m, const char *name)
+{
+	m->owner = 0;
+	init_waitqueue_head (&m->wait);
+#ifdef CONFIG_LOCK_STAT
+	{
+		struct lock_stat init = { name, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+		m->stat = init;
+	}
+#endif /* CONFIG_LOCK_STAT */
+}
+
+
+static inline int __mutex_trylock (struct mutex *m)
+{
+	return !m->owner &&
+		cmpxchg ( (volatile u32_t *) &m->owner, 0, (u32_t) current) == 0;
+}
+
+
+#ifdef CONFIG_LOCK_STAT
+
+/* Called by the new owner, so nobody else writes the numbers */
+
+static inline void mutex_acquired (struct mutex *m, u64_t wait_start)
+{
+	u64_t now = rdtsc();
+
+	if (!m->stat.registered) lock_stat_register (&m->stat);
+
+	if (wait_start){
+		m->stat.contended++;
+		m->stat.wait_cycles += now - wait_start;
+	}
+
+	m->stat.acquisitions++;
+	m->stat.acquired_at = now;
+}
+
+static inline void mutex_released (struct mutex *m)
+{
+	u64_t held = rdtsc() - m->stat.acquired_at;
+
+	m->stat.hold_cycles += held;
+	if (held > m->stat.max_hold_cycles) m->stat.max_hold_cycles = held;
+}
+
+#else
+
+#define mutex_acquired(m, wait_start)  ((void) (wait_start))
+#define mutex_released(m)
+
+#endif /* CONFIG_LOCK_STAT */
+
+
+/* Spin while `owner' holds `m' and is running. Returns 1 if it let go,
+ * 0 if it stopped running or we have to reschedule. */
+
+static int mutex_spin_on_owner (struct mutex *m, struct task *owner)
+{
+	while (m->owner == owner){
+		if (!task_on_cpu (owner) || need_resched()) return 0;
+		cpu_relax();
+	}
+
+	return 1;
+}
+
+
+void mutex_lock (struct mutex *m)
+{
+	struct task *owner;
+	u64_t start;
+
+	if (__mutex_trylock (m)){
+		mutex_acquired (m, 0);
+		return;
+	}
+
+	start = rdtsc();
+
+	for (;;){
+		if (__mutex_trylock (m)) goto out;
+
+		owner = m->owner;
+		if (owner && !mutex_spin_on_owner (m, owner)) break;
+	}
+
+	wait_event (m->wait, __mutex_trylock (m));
+
+ out:
+	mutex_acquired (m, start);
+}
+
+
+int mutex_trylock (struct mutex *m)
+{
+	if (!__mutex_trylock (m)) return 0;
+
+	mutex_acquired (m, 0);
+	return 1;
+}
+
+
+/* xchg is a full barrier, so the mutex is seen free before we look
+ * for sleepers. prepare_to_wait has the barrier on the other side,
+ * between a sleeper queueing itself and its try. With both, either
+ * the sleeper is seen here or its try sees the mutex free. */
+
+void mutex_unlock (struct mutex *m)
+{
+	mutex_released (m);
+
+	xchg ( (volatile u32_t *) &m->owner, 0);
+
+	if (waitqueue_active (&m->wait)) wake_up_one (&m->wait);
+}
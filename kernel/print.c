@@ -3,8 +3,7 @@
  * Copyright (C) 2003,  Apurva Mehta (with exceptions, see below)
  *                
  * File path:     kernel/print.c
- * Description:   Implementation of functions to print characters to
- *                the screen.
+ * Description:   Formatted printing to strings and to the console.
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -33,7 +32,384 @@
  ********************************************************************/
 
 
-/* The `printf' and `itoa' routines are under the following notice:
+#include <sys/types.h>
+#include <stdarg.h>
+#include <nodes/config.h>
+#include <asm/msr.h>
+#include <asm/div64.h>
+#include <nodes/time.h>
+#include <io.h>
+
+
+/* vsnprintf and printf share one formatting engine, which puts its
+ * output into a print_buf. When the buffer fills up, `flush' gets to
+ * empty it. Without a flush what does not fit is dropped but still
+ * counted, which is what vsnprintf wants.
+ *
+ * Numbers are built backwards from the end of a small buffer. Hex
+ * digits come from shifts and a table. Decimal digits come two at a
+ * time from a table of the pairs 00 to 99, so there is one division
+ * by 100 for every two digits, and values of 64 bits only go through
+ * do_div while they do not fit in 32.
+ */
+
+struct print_buf {
+	char *buf;
+	u32_t size;      /* Bytes that fit in buf */
+	u32_t pos;       /* Next free byte in buf */
+	u32_t total;     /* Bytes produced so far */
+	void (*flush) (struct print_buf *pb);
+};
+
+#define PRINTF_BUF  128   /* printf puts out this much at once */
+
+#define FL_LEFT   1       /* `-': pad on the right */
+#define FL_ZERO   2       /* `0': pad numbers with zeros */
+#define FL_PLUS   4       /* `+': sign on positive numbers too */
+#define FL_SPACE  8       /* ` ': a space in place of a plus */
+#define FL_ALT    16      /* `#': 0x in front of hex */
+
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
+
+static const char dec_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+
+static inline void emit (struct print_buf *pb, char c)
+{
+	if (pb->pos == pb->size && pb->flush) pb->flush (pb);
+	if (pb->pos < pb->size) pb->buf[pb->pos++] = c;
+	pb->total++;
+}
+
+static void emit_n (struct print_buf *pb, char c, int n)
+{
+	while (n-- > 0) emit (pb, c);
+}
+
+static void emit_str (struct print_buf *pb, const char *s, int n)
+{
+	while (n-- > 0) emit (pb, *s++);
+}
+
+
+static char *put_hex (char *end, u64_t v, const char *digits)
+{
+	u32_t low = (u32_t) v, high = (u32_t) (v >> 32);
+	int i;
+
+	if (high){
+		for (i = 0; i < 8; i++, low >>= 4) *--end = digits[low & 15];
+		low = high;
+	}
+
+	do {
+		*--end = digits[low & 15];
+	} while (low >>= 4);
+
+	return end;
+}
+
+static char *put_dec32 (char *end, u32_t v)
+{
+	u32_t q, r;
+
+	while (v >= 100){
+		q = v / 100;
+		r = (v - q * 100) * 2;
+		*--end = dec_pairs[r + 1];
+		*--end = dec_pairs[r];
+		v = q;
+	}
+
+	if (v >= 10){
+		*--end = dec_pairs[v * 2 + 1];
+		*--end = dec_pairs[v * 2];
+	}
+	else *--end = '0' + v;
+
+	return end;
+}
+
+static char *put_dec (char *end, u64_t v)
+{
+	u32_t r;
+
+	while (v >> 32){
+		r = do_div (&v, 100) * 2;
+		*--end = dec_pairs[r + 1];
+		*--end = dec_pairs[r];
+	}
+
+	return put_dec32 (end, (u32_t) v);
+}
+
+
+/* Put out the digits from `digits' to `end' with `prefix' in front,
+ * padded to `width' and to `prec' digits as the flags say */
+
+static void emit_number (struct print_buf *pb, const char *prefix,
+			 char *digits, char *end, int width, int prec,
+			 int flags)
+{
+	int len = end - digits, plen = 0, zeros = 0;
+
+	while (prefix[plen]) plen++;
+
+	if (prec > len) zeros = prec - len;
+	else if ( (flags & FL_ZERO) && !(flags & FL_LEFT) && prec < 0 &&
+		  width > plen + len)
+		zeros = width - plen - len;
+
+	width -= plen + zeros + len;
+
+	if (!(flags & FL_LEFT)) emit_n (pb, ' ', width);
+	emit_str (pb, prefix, plen);
+	emit_n (pb, '0', zeros);
+	emit_str (pb, digits, len);
+	if (flags & FL_LEFT) emit_n (pb, ' ', width);
+}
+
+
+static void do_format (struct print_buf *pb, const char *fmt, va_list ap)
+{
+	char tmp[24], *end = tmp + sizeof (tmp), *digits;
+	const char *prefix, *s;
+	int flags, width, prec, lng, len;
+	u64_t num;
+	s64_t snum;
+	char c;
+
+	while ( (c = *fmt++) != 0){
+		if (c != '%'){
+			emit (pb, c);
+			continue;
+		}
+
+		flags = 0;
+		for (;;){
+			c = *fmt++;
+			if (c == '-') flags |= FL_LEFT;
+			else if (c == '0') flags |= FL_ZERO;
+			else if (c == '+') flags |= FL_PLUS;
+			else if (c == ' ') flags |= FL_SPACE;
+			else if (c == '#') flags |= FL_ALT;
+			else break;
+		}
+
+		width = 0;
+		if (c == '*'){
+			width = va_arg (ap, int);
+			if (width < 0){
+				flags |= FL_LEFT;
+				width = -width;
+			}
+			c = *fmt++;
+		}
+		else while (c >= '0' && c <= '9'){
+			width = width * 10 + c - '0';
+			c = *fmt++;
+		}
+
+		prec = -1;
+		if (c == '.'){
+			prec = 0;
+			c = *fmt++;
+			if (c == '*'){
+				prec = va_arg (ap, int);
+				c = *fmt++;
+			}
+			else while (c >= '0' && c <= '9'){
+				prec = prec * 10 + c - '0';
+				c = *fmt++;
+			}
+		}
+
+		/* int and long are both 32 bits, only ll is wider */
+		lng = 0;
+		while (c == 'l' || c == 'h' || c == 'z'){
+			if (c == 'l') lng++;
+			c = *fmt++;
+		}
+
+		prefix = "";
+
+		switch (c){
+		case 'd':
+		case 'i':
+			snum = lng > 1 ? va_arg (ap, s64_t) : va_arg (ap, int);
+			if (snum < 0){
+				prefix = "-";
+				num = -snum;
+			}
+			else{
+				num = snum;
+				if (flags & FL_PLUS) prefix = "+";
+				else if (flags & FL_SPACE) prefix = " ";
+			}
+			digits = put_dec (end, num);
+			emit_number (pb, prefix, digits, end, width, prec, flags);
+			break;
+
+		case 'u':
+			num = lng > 1 ? va_arg (ap, u64_t) : va_arg (ap, u32_t);
+			digits = put_dec (end, num);
+			emit_number (pb, prefix, digits, end, width, prec, flags);
+			break;
+
+		case 'x':
+		case 'X':
+			num = lng > 1 ? va_arg (ap, u64_t) : va_arg (ap, u32_t);
+			if ( (flags & FL_ALT) && num) prefix = c == 'x' ? "0x" : "0X";
+			digits = put_hex (end, num, c == 'x' ? hex_lower : hex_upper);
+			emit_number (pb, prefix, digits, end, width, prec, flags);
+			break;
+
+		case 'p':
+			num = (u32_t) va_arg (ap, void *);
+			digits = put_hex (end, num, hex_lower);
+			emit_number (pb, "0x", digits, end, width, 8, flags);
+			break;
+
+		case 'c':
+			tmp[0] = (char) va_arg (ap, int);
+			emit_number (pb, prefix, tmp, tmp + 1, width, -1,
+				     flags & FL_LEFT);
+			break;
+
+		case 's':
+			s = va_arg (ap, const char *);
+			if (!s) s = "(null)";
+			for (len = 0; s[len] && (prec < 0 || len < prec); len++)
+				;
+			if (!(flags & FL_LEFT)) emit_n (pb, ' ', width - len);
+			emit_str (pb, s, len);
+			if (flags & FL_LEFT) emit_n (pb, ' ', width - len);
+			break;
+
+		case '%':
+			emit (pb, '%');
+			break;
+
+		case 0:
+			return;
+
+		default:
+			/* Not a conversion we know, show it as it is */
+			emit (pb, '%');
+			emit (pb, c);
+		}
+	}
+}
+
+
+int vsnprintf (char *buf, u32_t size, const char *format, va_list ap)
+{
+	struct print_buf pb;
+
+	pb.buf = buf;
+	pb.size = size ? size - 1 : 0;   /* Room for the terminator */
+	pb.pos = 0;
+	pb.total = 0;
+	pb.flush = 0;
+
+	do_format (&pb, format, ap);
+
+	if (size) buf[pb.pos] = 0;
+
+	return pb.total;
+}
+
+
+int snprintf (char *buf, u32_t size, const char *format, ...)
+{
+	va_list ap;
+	int ret;
+
+	va_start (ap, format);
+	ret = vsnprintf (buf, size, format, ap);
+	va_end (ap);
+
+	return ret;
+}
+
+
+static void console_flush (struct print_buf *pb)
+{
+	console_write (pb->buf, pb->pos);
+	pb->pos = 0;
+}
+
+
+/* The whole output goes to the console under one console_begin, so
+ * lines from other processors do not get mixed in. */
+
+int vprintf (const char *format, va_list ap)
+{
+	char buf[PRINTF_BUF];
+	struct print_buf pb;
+	u32_t flags;
+
+	pb.buf = buf;
+	pb.size = sizeof (buf);
+	pb.pos = 0;
+	pb.total = 0;
+	pb.flush = console_flush;
+
+	flags = console_begin();
+
+	do_format (&pb, format, ap);
+	console_flush (&pb);
+
+	console_end (flags);
+
+	return pb.total;
+}
+
+
+/* Format a string and print it on the screen, just like the libc
+   function printf.  */
+int printf (const char *format, ...)
+{
+	va_list ap;
+	int ret;
+
+	va_start (ap, format);
+	ret = vprintf (format, ap);
+	va_end (ap);
+
+	return ret;
+}
+
+
+
+/* Print the result of one step of a boot time check */
+
+void boot_check (const char *what, int got, int want)
+{
+	printf ("  %s : %d", what, got);
+	if (got == want) printf (" ok\n");
+	else printf (", expected %d FAILED\n", want);
+}
+
+
+
+/* =============== bench_printf =============== */
+
+#ifdef CONFIG_BENCH
+
+/* The `legacy_printf' and `itoa' routines, which are only kept to
+ * measure printf against, are under the following notice:
  *
  * Copyright (C) 1999  Free Software Foundation, Inc.
  *  
@@ -53,24 +429,20 @@
  */
 
 
-#include <io.h>
-
-extern screen scr;
+static char legacy_out[PRINTF_BUF];
+static u32_t legacy_pos;
 
-/* Inserts a newline on the screen */
-
-inline static void insert_newline()
+/* Where legacy_printf puts its characters, one call each */
+static void legacy_putc (char c)
 {
-	scr.xpos++;
-	scr.ypos = 0;
+	legacy_out[legacy_pos++ & (PRINTF_BUF - 1)] = c;
 }
 
-
 static void itoa(char*, int, int);
 
-/* Format a string and print it on the screen, just like the libc
-   function printf.  */
-void printf (const char *format, ...)
+/* The printf we used to have. It finds its arguments by walking the
+   stack and puts out a character at a time.  */
+static void legacy_printf (const char *format, ...)
 {
 	char **arg = (char **) &format;
 	int c; 
@@ -81,7 +453,7 @@ void printf (const char *format, ...)
 	while ((c = *format++) != 0)
 	{
 		if (c != '%')
-			putchar (c);
+			legacy_putc (c);
 		else
 		{
 			char *p;
@@ -104,78 +476,17 @@ void printf (const char *format, ...)
 
 			string:
 				while (*p)
-					putchar (*p++);
+					legacy_putc (*p++);
 				break;
 
 			default:
-				putchar (*((int *) arg++));
+				legacy_putc (*((int *) arg++));
 				break;
 			}
 		}
 	}
 }
 
-/* Put character `c' on the screen at the current cursor position and then
- * move the cursor to the next location.
- */
-
-void putchar (char c)
-{
-	if ( c == '\n' || c == '\r') insert_newline();
-	else if ( c == '\t' ) scr.ypos += 8;
-	else{
-
-		if ( scr.ypos >= scr.cols*2 ) insert_newline();
-
-		*(scr.video + (scr.xpos * scr.cols * 2 + scr.ypos++)) = c;
-		*(scr.video + (scr.xpos * scr.cols * 2 + scr.ypos++)) = scr.attribute;
-		
-	}
-	
-	if ( scr.xpos >= scr.rows) cls();
-
-}
-
-
-/* Initializes the screen whose properties are in global varible scr
- * of type screen.
- */
-
-void init_screen( unsigned int rows,
-		 unsigned int cols, 
-		 char attribute)
-{
-	int i ;
-	scr.rows = rows;
-	scr.cols = cols;
-
-	scr.attribute = attribute;
-
-	scr.video = (unsigned char*) 0xb8000;
-
-	for ( i = 0; i < rows * cols * 2; i++){
-		*(scr.video + i) = 0;
-	}
-
-	scr.xpos = 0;
-	scr.ypos = 0;
-}
-
-
-/* Clear the screen */
-void cls (void)
-{
- 	int i ; 
-	  
-	for (i = 0; i < scr.rows * scr.cols * 2; i++){
-		*(scr.video + i) = 0;
-	} 
-
-	scr.xpos = 0;
-	scr.ypos = 0;
-
-}
-
 /* Convert the integer D to a string and save the string in BUF. If
    BASE is equal to 'd', interpret that D is decimal, and if BASE is
    equal to 'x', interpret that D is hexadecimal.  */
@@ -220,3 +531,75 @@ static void itoa (char *buf, int base, int d)
 		p2--;
 	}
 }
+
+
+#define BENCH_PRINT_ROUNDS  10000
+#define BENCH_PRINT_LINES   50
+
+#define BENCH_FMT  "cpu %d: %u pages at 0x%x, %s\n"
+#define BENCH_ARGS -3, 123456789, 0xc0ffee, "page_alloc"
+
+
+/* Bytes per second for `bytes' bytes in `cycles' */
+
+static u32_t bytes_per_sec (u32_t bytes, u64_t cycles)
+{
+	u64_t us = cycles_to_ns (cycles), b = (u64_t) bytes * 1000000;
+
+	do_div (&us, 1000);
+	if (!us) return 0;
+
+	do_div (&b, (u32_t) us);
+	return (u32_t) b;
+}
+
+
+/* Format the same line with the old printf and with vsnprintf, into
+ * memory, and then print it BENCH_PRINT_LINES times to the console,
+ * with the old printf and the two byte stores per character of the
+ * old putchar, and with printf through the shadow. */
+
+void bench_printf (void)
+{
+	char buf[PRINTF_BUF];
+	u64_t start, old_fmt, new_fmt, old_con, new_con;
+	u32_t bytes, flags, i, j;
+
+	bytes = snprintf (buf, sizeof (buf), BENCH_FMT, BENCH_ARGS);
+
+	start = rdtsc();
+	for (i = 0; i < BENCH_PRINT_ROUNDS; i++)
+		legacy_printf (BENCH_FMT, BENCH_ARGS);
+	old_fmt = rdtsc() - start;
+
+	start = rdtsc();
+	for (i = 0; i < BENCH_PRINT_ROUNDS; i++)
+		snprintf (buf, sizeof (buf), BENCH_FMT, BENCH_ARGS);
+	new_fmt = rdtsc() - start;
+
+	start = rdtsc();
+	for (i = 0; i < BENCH_PRINT_LINES; i++){
+		legacy_pos = 0;
+		legacy_printf (BENCH_FMT, BENCH_ARGS);
+
+		flags = console_begin();
+		for (j = 0; j < legacy_pos; j++) legacy_putchar (legacy_out[j]);
+		console_end (flags);
+	}
+	old_con = rdtsc() - start;
+
+	start = rdtsc();
+	for (i = 0; i < BENCH_PRINT_LINES; i++)
+		printf (BENCH_FMT, BENCH_ARGS);
+	new_con = rdtsc() - start;
+
+	printf ("\nFormatting, %u byte lines :\n", bytes);
+	printf ("  to memory  : old %u bytes/s, vsnprintf %u bytes/s\n",
+		bytes_per_sec (bytes * BENCH_PRINT_ROUNDS, old_fmt),
+		bytes_per_sec (bytes * BENCH_PRINT_ROUNDS, new_fmt));
+	printf ("  to console : old %u bytes/s, printf %u bytes/s\n",
+		bytes_per_sec (bytes * BENCH_PRINT_LINES, old_con),
+		bytes_per_sec (bytes * BENCH_PRINT_LINES, new_con));
+}
+
+#endif /* CONFIG_BENCH */
@@ -0,0 +1,156 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/profile.c
+ * Description:   The sampling profiler.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* A sample is a lookup of the interrupted eip in the table of kernel
+ * functions (see kernel/ksyms.c) and an increment of the count of the
+ * function found, in the counts of the processor taking it, so
+ * processors never write the same cache lines.
+ *
+ * The samples come from the timer tick, at HZ. With CONFIG_NO_HZ an
+ * idle processor has no tick, so the idle loop gets fewer samples
+ * than the time it takes up. What is left is where the busy time
+ * goes.
+ *
+ * The report goes to the kernel log at LOG_DEBUG, which only the
+ * serial port prints.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/profile.h>
+#include <nodes/ksyms.h>
+#include <nodes/sched.h>
+#include <nodes/mutex.h>
+#include <nodes/log.h>
+#include <asm/interrupt.h>
+#include <asm/div64.h>
+#include <asm/smp.h>
+
+
+#ifdef CONFIG_PROFILE
+
+#define PROF_TOP  20   /* Functions in the report */
+
+/* Samples per function and processor. The last slot counts the ones
+ * that were in no function we know of. */
+static u32_t prof_hits[NR_CPUS][KSYM_MAX + 1];
+
+static u32_t prof_total[KSYM_MAX + 1];  /* Used by profile_print */
+
+static volatile u32_t prof_on;
+
+static DEFINE_MUTEX (prof_mutex);
+
+
+void profile_tick (void)
+{
+	struct irq_frame *frame;
+
+	if (!prof_on) return;
+
+	frame = get_irq_frame();
+	if (!frame) return;
+
+	prof_hits[smp_processor_id()][ksym_lookup (frame->eip)]++;
+}
+
+
+/* `n' as a percentage of `total', in tenths */
+
+static u32_t permille (u32_t n, u32_t total)
+{
+	u64_t p = (u64_t) n * 1000;
+
+	do_div (&p, total);
+	return (u32_t) p;
+}
+
+
+void profile_print (void)
+{
+	u32_t cpu, i, j, best, total = 0, sum = 0, pct, cum;
+
+	mutex_lock (&prof_mutex);
+
+	for (i = 0; i <= KSYM_MAX; i++){
+		prof_total[i] = 0;
+
+		for (cpu = 0; cpu < num_online_cpus; cpu++){
+			prof_total[i] += prof_hits[cpu][i];
+			prof_hits[cpu][i] = 0;
+		}
+
+		total += prof_total[i];
+	}
+
+	printk (LOG_DEBUG, "Profile: %u samples at %u Hz on %u processors\n",
+		total, HZ, num_online_cpus);
+
+	if (!total) goto out;
+
+	printk (LOG_DEBUG, "samples      %%    cum%%  function\n");
+
+	for (i = 0; i < PROF_TOP; i++){
+		best = 0;
+
+		for (j = 1; j <= KSYM_MAX; j++)
+			if (prof_total[j] > prof_total[best]) best = j;
+
+		if (!prof_total[best]) break;
+
+		sum += prof_total[best];
+		pct = permille (prof_total[best], total);
+		cum = permille (sum, total);
+
+		printk (LOG_DEBUG, "%7u %3u.%u%% %3u.%u%%  %s\n", prof_total[best],
+			pct / 10, pct % 10, cum / 10, cum % 10,
+			ksym_name (best));
+
+		prof_total[best] = 0;
+	}
+
+ out:
+	mutex_unlock (&prof_mutex);
+}
+
+
+void init_profile (void)
+{
+	printk (LOG_INFO, "Profiling %u functions at %u Hz\n", ksym_count(), HZ);
+
+	prof_on = 1;
+}
+
+#endif /* CONFIG_PROFILE */
@@ -0,0 +1,684 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/sched.c
+ * Description:   Kernel threads and the scheduler.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* Every processor has its own run queue and its own idle task. The
+ * boot context becomes the idle task of processor 0. It runs on the
+ * boot stack from boot.S, which is laid out like the page of any
+ * other task. The idle task is never put on the run queue. schedule
+ * falls back to it when nothing else can run.
+ *
+ * The run queue has one FIFO list per priority and a bitmap with a
+ * bit set for every list that is not empty. The next task is the head
+ * of the list of the lowest set bit, found with a single bsf, so the
+ * cost of picking it does not depend on how many tasks are waiting.
+ * The task that is running is not on the queue.
+ *
+ * The scheduler is preemptive. A task that wakes up with a better
+ * priority than the current one, or a time slice that runs out, sets
+ * need_resched on the current task. Interrupts check the flag on
+ * their way out and switch tasks there. Tasks of the same priority
+ * share the processor round robin, DEF_TIMESLICE ticks at a time.
+ *
+ * A run queue is only changed with its lock held and interrupts
+ * disabled. schedule keeps the lock across the switch, the next task
+ * drops it in finish_task_switch. A task is woken onto the queue it
+ * last ran on, so a task that is still on its way off a processor can
+ * not be picked by another one before it has left.
+ *
+ * Work moves between processors by stealing. On every tick a
+ * processor with more than one task waiting offers half of its least
+ * important ones in a lock free deque (see nodes/deque.h), and takes
+ * back whatever was not stolen on the next tick. A processor that
+ * runs out of work steals from the others before it goes idle. The
+ * busy processor never has to stop for a thief.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/sched.h>
+#include <nodes/list.h>
+#include <nodes/deque.h>
+#include <nodes/time.h>
+#include <asm/interrupt.h>
+#include <nodes/spinlock.h>
+#include <asm/smp.h>
+#include <asm/msr.h>
+#include <asm/div64.h>
+#include <asm/bitops.h>
+#include <asm/atomic.h>
+#include <mm/mm.h>
+#include <io.h>
+
+
+void ret_from_kthread (void);
+
+
+struct runqueue {
+	spinlock_t lock;
+	u32_t bitmap;                        /* Bit n set if queue[n]
+					      * is not empty */
+	u32_t nr_running;                    /* Tasks queued */
+	struct list_head queue[MAX_PRIO];
+
+	struct task *curr;                   /* Running on this
+					      * processor */
+	struct task *idle;
+
+	struct ws_deque offered;             /* Tasks up for stealing */
+};
+
+static DEFINE_PER_CPU (struct runqueue, runqueues);
+
+#define cpu_rq(cpu)  (&per_cpu (runqueues, cpu))
+#define this_rq()    this_cpu_ptr (runqueues)
+
+/* Threads are created on any processor, the ids are handed out with
+ * xadd */
+static volatile u32_t next_id = 1;
+
+
+/* Every run queue lock gets the name of its processor, so the lock
+ * statistics tell them apart */
+static char rq_lock_names[NR_CPUS][8];
+
+
+static void init_runqueue (struct runqueue *rq, const char *name)
+{
+	int i;
+
+	__spin_lock_init (&rq->lock, name);
+	rq->bitmap = 0;
+	rq->nr_running = 0;
+
+	for (i = 0; i < MAX_PRIO; i++)
+		INIT_LIST_HEAD (&rq->queue[i]);
+
+	ws_deque_init (&rq->offered);
+}
+
+
+static inline void enqueue_task (struct runqueue *rq, struct task *task)
+{
+	list_add_tail (&task->run_list, &rq->queue[task->prio]);
+	rq->bitmap |= (1 << task->prio);
+	rq->nr_running++;
+}
+
+
+static inline void dequeue_task (struct runqueue *rq, struct task *task)
+{
+	list_del (&task->run_list);
+	if (list_empty (&rq->queue[task->prio]))
+		rq->bitmap &= ~(1 << task->prio);
+	rq->nr_running--;
+}
+
+
+/* True if `task' is on one of the lists of its run queue. list_del
+ * leaves a null next pointer behind. */
+
+static inline int task_queued (struct task *task)
+{
+	return task->run_list.next != 0;
+}
+
+
+/* Take the most important task off `rq'. Returns null if it is empty. */
+
+static inline struct task *pick_next_task (struct runqueue *rq)
+{
+	struct task *next;
+
+	if (!rq->bitmap) return 0;
+
+	next = list_entry (rq->queue[__ffs (rq->bitmap)].next,
+			   struct task, run_list);
+	dequeue_task (rq, next);
+
+	return next;
+}
+
+
+/* Lock the run queue `task' belongs to. The task may move while we
+ * wait for the lock, in which case we try again. Interrupts must be
+ * disabled. */
+
+static struct runqueue *task_rq_lock (struct task *task)
+{
+	struct runqueue *rq;
+
+	for (;;){
+		rq = cpu_rq (task->cpu);
+		raw_spin_lock (&rq->lock);
+		if (rq == cpu_rq (task->cpu)) return rq;
+		raw_spin_unlock (&rq->lock);
+	}
+}
+
+
+/* Ask `task', which is running, to call schedule. A processor other
+ * than ours may be halted in its idle loop, so it gets an interrupt. */
+
+static void resched_task (struct task *task)
+{
+	task->need_resched = 1;
+
+	if (task->cpu != smp_processor_id())
+		smp_send_reschedule (task->cpu);
+}
+
+
+#ifdef CONFIG_SMP
+
+/* Take back the tasks nobody stole and offer half of those that are
+ * waiting, least important first. The queue must be locked. */
+
+static void offer_tasks (struct runqueue *rq)
+{
+	struct task *task;
+	u32_t n;
+
+	while ( (task = ws_pop (&rq->offered)) != 0)
+		enqueue_task (rq, task);
+
+	if (num_online_cpus < 2) return;
+
+	for (n = rq->nr_running / 2; n; n--){
+		task = list_entry (rq->queue[__fls (rq->bitmap)].prev,
+				   struct task, run_list);
+		if (task->pinned) break;
+
+		dequeue_task (rq, task);
+		if (!ws_push (&rq->offered, task)){
+			enqueue_task (rq, task);
+			break;
+		}
+	}
+}
+
+
+/* Find a task for this processor, which has nothing queued. Our own
+ * offers come first. The queue must be locked. */
+
+static struct task *steal_task (struct runqueue *rq)
+{
+	struct task *task;
+	u32_t cpu, i;
+
+	task = ws_pop (&rq->offered);
+	if (task) return task;
+
+	cpu = smp_processor_id();
+
+	for (i = 1; i < num_online_cpus; i++){
+		task = ws_steal (&cpu_rq ( (cpu + i) % num_online_cpus)->offered);
+		if (task){
+			task->cpu = cpu;
+			return task;
+		}
+	}
+
+	return 0;
+}
+
+
+int sched_work_available (void)
+{
+	u32_t cpu;
+
+	for (cpu = 0; cpu < num_online_cpus; cpu++){
+		if (ws_deque_size (&cpu_rq (cpu)->offered))
+			return 1;
+	}
+
+	return 0;
+}
+
+#else
+
+#define offer_tasks(rq)
+#define steal_task(rq) 0
+
+int sched_work_available (void)
+{
+	return 0;
+}
+
+#endif /* CONFIG_SMP */
+
+
+/* rq->curr is read without the lock, so the answer may be stale by
+ * the time it is used. Good enough to decide whether to keep
+ * spinning. */
+
+int task_on_cpu (struct task *task)
+{
+	return cpu_rq (task->cpu)->curr == task;
+}
+
+
+/* Called right after every switch, on the stack of the new task, with
+ * the task we switched away from. That is the first point at which
+ * the stack of prev is no longer in use, so the run queue can be
+ * unlocked and the stack of a dead task freed.
+ */
+
+void finish_task_switch (struct task *prev)
+{
+	raw_spin_unlock (&this_rq()->lock);
+
+	if (prev->state == TASK_DEAD)
+		deallocate_page ( (u32_t) prev);
+}
+
+
+/* A task that is preempted stays runnable whatever its state. It may
+ * have marked itself blocked and been about to check whether it still
+ * has to sleep. If it had to, it calls schedule again itself. */
+
+static void __schedule (int preempt)
+{
+	struct task *prev = current, *next;
+	struct runqueue *rq;
+	u32_t flags;
+
+	local_irq_save (flags);
+
+	rq = this_rq();
+	raw_spin_lock (&rq->lock);
+
+	prev->need_resched = 0;
+
+	if (prev != rq->idle){
+		if (prev->state == TASK_RUNNING || preempt)
+			enqueue_task (rq, prev);
+		else
+			prev->on_rq = 0;
+	}
+
+	next = pick_next_task (rq);
+	if (!next) next = steal_task (rq);
+	if (!next) next = rq->idle;
+
+	if (next != prev){
+		rq->curr = next;
+		prev = switch_to (prev, next);
+		finish_task_switch (prev);
+	}
+	else
+		raw_spin_unlock (&rq->lock);
+
+	local_irq_restore (flags);
+}
+
+
+void schedule (void)
+{
+	__schedule (0);
+}
+
+
+void preempt_schedule (void)
+{
+	__schedule (1);
+}
+
+
+void yield (void)
+{
+	schedule();
+}
+
+
+/* The idle task has IDLE_PRIO, so any wakeup preempts it. A task that
+ * has blocked but not yet called schedule is still on_rq. It only
+ * has to be marked running again, schedule will then requeue it. */
+
+void wake_up_task (struct task *task)
+{
+	struct runqueue *rq;
+	u32_t flags;
+
+	local_irq_save (flags);
+	rq = task_rq_lock (task);
+
+	if (task->state == TASK_BLOCKED){
+		task->state = TASK_RUNNING;
+
+		if (!task->on_rq){
+			task->on_rq = 1;
+			enqueue_task (rq, task);
+
+			if (task->prio < rq->curr->prio)
+				resched_task (rq->curr);
+		}
+	}
+
+	raw_spin_unlock (&rq->lock);
+	local_irq_restore (flags);
+}
+
+
+void set_task_prio (struct task *task, u32_t prio)
+{
+	struct runqueue *rq;
+	u32_t flags;
+
+	if (prio >= MAX_PRIO) prio = MAX_PRIO - 1;
+
+	local_irq_save (flags);
+	rq = task_rq_lock (task);
+
+	if (task_queued (task)){
+		dequeue_task (rq, task);
+		task->prio = prio;
+		enqueue_task (rq, task);
+
+		if (prio < rq->curr->prio)
+			resched_task (rq->curr);
+	}
+	else{
+		task->prio = prio;
+
+		/* Lowered a running task below a waiting one */
+		if (task == rq->curr && rq->bitmap &&
+		    __ffs (rq->bitmap) < prio)
+			resched_task (task);
+	}
+
+	raw_spin_unlock (&rq->lock);
+	local_irq_restore (flags);
+}
+
+
+/* When the slice runs out the task goes to the back of its queue on
+ * the next interrupt exit, behind the others of its priority. */
+
+void scheduler_tick (void)
+{
+	struct runqueue *rq = this_rq();
+	struct task *task = rq->curr;
+
+	raw_spin_lock (&rq->lock);
+
+	if (task != rq->idle && --task->time_slice == 0){
+		task->time_slice = DEF_TIMESLICE;
+		task->need_resched = 1;
+	}
+
+	offer_tasks (rq);
+
+	raw_spin_unlock (&rq->lock);
+}
+
+
+/* Called by irq_exit with interrupts disabled, on the stack of the
+ * interrupted task. The interrupt frame stays on that stack until the
+ * task is switched back to, schedule returns here and the interrupt
+ * returns as usual.
+ *
+ * The idle task runs with preemption disabled. It may be halted with
+ * the tick stopped and has to restart it before it schedules, which
+ * its loop does as soon as the interrupt returns to it.
+ */
+
+void preempt_schedule_irq (void)
+{
+	if (current->need_resched && !current->preempt_count)
+		__schedule (1);
+}
+
+
+/* Every thread starts here, with interrupts disabled since it was
+ * switched to from inside schedule. */
+
+void kthread_main (void)
+{
+	sti();
+
+	current->fn (current->arg);
+
+	kthread_exit();
+}
+
+
+void kthread_exit (void)
+{
+	cli();
+	current->state = TASK_DEAD;
+	schedule();
+
+	/* Not reached */
+	for (;;)
+		;
+}
+
+
+static void init_task (struct task *task, const char *name, u32_t cpu)
+{
+	task->name = name;
+	task->prio = DEFAULT_PRIO;
+	task->time_slice = DEF_TIMESLICE;
+	task->need_resched = 0;
+	task->preempt_count = 0;
+	task->cpu = cpu;
+	task->on_rq = 0;
+	task->pinned = 0;
+	task->run_list.next = task->run_list.prev = 0;
+}
+
+
+/* The new stack is made to look as if the thread had called
+ * switch_to from ret_from_kthread: four saved registers and a return
+ * address. It starts on the run queue of processor `cpu'. */
+
+static struct task *__kthread_create (void (*fn) (void *), void *arg,
+				      const char *name, u32_t cpu, u32_t pinned)
+{
+	struct task *task;
+	u32_t *sp;
+
+	task = (struct task *) allocate_page (LOW_MEM_ZONE);
+	if (!task) return 0;
+
+	init_task (task, name, cpu);
+	task->pinned = pinned;
+	task->id = xadd (&next_id, 1);
+	task->state = TASK_BLOCKED;
+	task->fn = fn;
+	task->arg = arg;
+
+	sp = (u32_t *) ( (u32_t) task + THREAD_SIZE);
+	*--sp = (u32_t) ret_from_kthread;
+	*--sp = 0;   /* ebp */
+	*--sp = 0;   /* ebx */
+	*--sp = 0;   /* esi */
+	*--sp = 0;   /* edi */
+	task->esp = (u32_t) sp;
+
+	wake_up_task (task);
+
+	return task;
+}
+
+
+struct task *kthread_create (void (*fn) (void *), void *arg, const char *name)
+{
+	return __kthread_create (fn, arg, name, smp_processor_id(), 0);
+}
+
+
+struct task *kthread_create_on_cpu (void (*fn) (void *), void *arg,
+				    const char *name, u32_t cpu)
+{
+	if (cpu >= num_online_cpus) return 0;
+
+	return __kthread_create (fn, arg, name, cpu, 1);
+}
+
+
+/* The idle tasks run with preemption disabled and are always on_rq
+ * from the point of view of wake_up_task. */
+
+static void init_idle (struct task *idle, u32_t cpu)
+{
+	struct runqueue *rq = cpu_rq (cpu);
+
+	init_task (idle, "idle", cpu);
+	idle->id = 0;
+	idle->state = TASK_RUNNING;
+	idle->prio = IDLE_PRIO;
+	idle->preempt_count = 1;
+	idle->on_rq = 1;
+	idle->pinned = 1;
+
+	snprintf (rq_lock_names[cpu], sizeof (rq_lock_names[cpu]),
+		  "rq%u.lock", cpu);
+	init_runqueue (rq, rq_lock_names[cpu]);
+	rq->curr = rq->idle = idle;
+}
+
+
+struct task *fork_idle (u32_t cpu)
+{
+	struct task *idle;
+
+	idle = (struct task *) allocate_page (LOW_MEM_ZONE);
+	if (idle) init_idle (idle, cpu);
+
+	return idle;
+}
+
+
+void init_sched (void)
+{
+	init_idle (current, 0);
+}
+
+
+
+/* =============== bench_sched =============== */
+
+#ifdef CONFIG_BENCH
+
+#define PING_PONG_ROUNDS 100000
+
+static void ping_pong (void *arg)
+{
+	int i;
+
+	for (i = 0; i < PING_PONG_ROUNDS; i++) yield();
+}
+
+
+#define PICK_TASKS   4096     /* Most tasks queued at once */
+#define PICK_ROUNDS  100000
+
+static struct task pick_tasks[PICK_TASKS];
+
+
+/* Queue `n' dummy tasks, spread over all the priorities, on a private
+ * run queue and time picking the next one and putting it back, which
+ * is what a round robin switch does. Nothing here needs a stack, so
+ * the tasks are never run. */
+
+static void bench_pick_next (void)
+{
+	static struct runqueue rq;
+	struct task *task;
+	u64_t start, cycles;
+	u32_t n, i;
+
+	printf ("\nPick next task :\n");
+
+	for (n = 1; n <= PICK_TASKS; n *= 4){
+		init_runqueue (&rq, "bench rq.lock");
+
+		for (i = 0; i < n; i++){
+			pick_tasks[i].prio = i % MAX_PRIO;
+			enqueue_task (&rq, &pick_tasks[i]);
+		}
+
+		start = rdtsc();
+		for (i = 0; i < PICK_ROUNDS; i++){
+			task = pick_next_task (&rq);
+			enqueue_task (&rq, task);
+		}
+		cycles = rdtsc() - start;
+
+		do_div (&cycles, PICK_ROUNDS);
+		printf ("  %u tasks : %u cycles\n", n, (u32_t) cycles);
+	}
+}
+
+
+/* Two threads yield to each other PING_PONG_ROUNDS times each. The
+ * idle task steps aside by calling schedule once and gets the
+ * processor back when both have exited. Both are pinned before the
+ * tick can offer them to another processor. */
+
+void bench_sched (void)
+{
+	struct task *ping, *pong;
+	u64_t start, cycles;
+	u32_t flags;
+
+	local_irq_save (flags);
+
+	ping = kthread_create (ping_pong, 0, "ping");
+	pong = kthread_create (ping_pong, 0, "pong");
+	if (ping) ping->pinned = 1;
+	if (pong) pong->pinned = 1;
+
+	local_irq_restore (flags);
+
+	if (!ping || !pong){
+		printf ("bench_sched: out of memory\n");
+		return;
+	}
+
+	start = rdtsc();
+	schedule();
+	cycles = rdtsc() - start;
+
+	do_div (&cycles, 2 * PING_PONG_ROUNDS);
+
+	printf ("\nContext switch : %u cycles, %u ns\n", (u32_t) cycles,
+		(u32_t) cycles_to_ns (cycles));
+
+	bench_pick_next();
+}
+
+#endif /* CONFIG_BENCH */
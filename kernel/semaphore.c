@@ -0,0 +1,227 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/semaphore.c
+ * Description:   Counting semaphores and completions.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* Both are a counter and a wait queue. Taking a unit is a compare and
+ * swap on the counter, giving one back is a locked add, so neither
+ * needs a lock of its own. A sleeper queues itself and then tries to
+ * take a unit, with a full barrier in between (see prepare_to_wait),
+ * and the locked add is a full barrier before the giver looks for
+ * sleepers, so a wakeup is never lost.
+ */
+
+#include <sys/types.h>
+#include <nodes/sched.h>
+#include <nodes/wait.h>
+#include <nodes/semaphore.h>
+#include <asm/atomic.h>
+#include <io.h>
+
+
+#define COMPLETE_ALL  0x7fffffff   /* Never runs out */
+
+
+/* Take a unit of `count' if there is one */
+
+static int take_unit (volatile u32_t *count)
+{
+	u32_t c;
+
+	while ( (c = *count) != 0){
+		if (cmpxchg (count, c, c - 1) == c) return 1;
+	}
+
+	return 0;
+}
+
+
+void sema_init (struct semaphore *sem, u32_t n)
+{
+	sem->count = n;
+	init_waitqueue_head (&sem->wait);
+}
+
+
+void down (struct semaphore *sem)
+{
+	if (take_unit (&sem->count)) return;
+
+	wait_event (sem->wait, take_unit (&sem->count));
+}
+
+
+int down_trylock (struct semaphore *sem)
+{
+	return take_unit (&sem->count);
+}
+
+
+void up (struct semaphore *sem)
+{
+	xadd (&sem->count, 1);
+
+	if (waitqueue_active (&sem->wait)) wake_up_one (&sem->wait);
+}
+
+
+/* Like take_unit, but COMPLETE_ALL is left alone */
+
+static int take_done (struct completion *x)
+{
+	u32_t d;
+
+	while ( (d = x->done) != 0){
+		if (d == COMPLETE_ALL) return 1;
+		if (cmpxchg (&x->done, d, d - 1) == d) return 1;
+	}
+
+	return 0;
+}
+
+
+void init_completion (struct completion *x)
+{
+	x->done = 0;
+	init_waitqueue_head (&x->wait);
+}
+
+
+void wait_for_completion (struct completion *x)
+{
+	if (take_done (x)) return;
+
+	wait_event (x->wait, take_done (x));
+}
+
+
+void complete (struct completion *x)
+{
+	u32_t d;
+
+	/* Do not count past complete_all */
+	do {
+		d = x->done;
+		if (d == COMPLETE_ALL) return;
+	} while (cmpxchg (&x->done, d, d + 1) != d);
+
+	if (waitqueue_active (&x->wait)) wake_up_one (&x->wait);
+}
+
+
+void complete_all (struct completion *x)
+{
+	xchg (&x->done, COMPLETE_ALL);
+
+	wake_up (&x->wait);
+}
+
+
+/* A boot time check that down sleeps until up gives it a unit, that
+ * each up lets exactly one sleeper through and a spare unit is kept,
+ * and that complete wakes one waiter and complete_all the rest.
+ * Threads pinned to processor 0 do the sleeping, and we, the idle
+ * task, count how many got through each time schedule hands the
+ * processor back. */
+
+#define SEMA_TEST_THREADS  2
+
+static struct semaphore test_sem;
+static struct completion test_done;
+static volatile u32_t test_downs, test_completed;
+
+
+static void sema_downer (void *arg)
+{
+	down (&test_sem);
+	xadd (&test_downs, 1);
+}
+
+
+static void completion_waiter (void *arg)
+{
+	wait_for_completion (&test_done);
+	xadd (&test_completed, 1);
+}
+
+
+void test_semaphore (void)
+{
+	u32_t i, started = 0;
+
+	printf ("\nTesting semaphores and completions with %u sleepers each :\n",
+		SEMA_TEST_THREADS);
+
+	sema_init (&test_sem, 0);
+	init_completion (&test_done);
+	test_downs = test_completed = 0;
+
+	for (i = 0; i < SEMA_TEST_THREADS; i++){
+		if (kthread_create_on_cpu (sema_downer, 0, "sema_downer", 0))
+			started++;
+		if (kthread_create_on_cpu (completion_waiter, 0,
+					   "completion_waiter", 0))
+			started++;
+	}
+
+	if (started != 2 * SEMA_TEST_THREADS){
+		printf ("  out of memory\n");
+		return;
+	}
+
+	schedule();
+
+	boot_check ("down_trylock with no units", down_trylock (&test_sem), 0);
+	boot_check ("downs before up", test_downs, 0);
+
+	up (&test_sem);
+	schedule();
+	boot_check ("downs after one up", test_downs, 1);
+
+	up (&test_sem);
+	up (&test_sem);
+	schedule();
+	boot_check ("downs after three ups", test_downs, SEMA_TEST_THREADS);
+	boot_check ("down_trylock on the unit left", down_trylock (&test_sem), 1);
+
+	boot_check ("completed before complete", test_completed, 0);
+
+	complete (&test_done);
+	schedule();
+	boot_check ("completed after complete", test_completed, 1);
+
+	complete_all (&test_done);
+	schedule();
+	boot_check ("completed after complete_all", test_completed,
+		    SEMA_TEST_THREADS);
+}
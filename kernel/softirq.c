@@ -0,0 +1,140 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/softirq.c
+ * Description:   Deferred work that runs on the way out of an interrupt
+ *                with interrupts enabled.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* A hard irq handler runs with interrupts disabled and the PIC not
+ * yet acknowledged, so anything slow it does directly adds to the
+ * latency of every other interrupt. Softirqs let it hand the slow
+ * part off. The handler marks a softirq pending and irq_exit runs it
+ * once the PIC has been acknowledged, with interrupts enabled.
+ *
+ * Interrupts that arrive while softirqs are running do not run them
+ * again. They just add to the pending mask and the outermost
+ * irq_exit picks the work up before it returns.
+ *
+ * irq_exit is also where the scheduler preempts a task, once all the
+ * deferred work of the interrupt is done.
+ *
+ * Every processor has its own pending mask and runs its own softirqs.
+ * A softirq is not preempted, so it stays on the processor that
+ * raised it.
+ *
+ * Raised outside an interrupt, by a printk from a thread say, a
+ * softirq waits for the next irq_exit. So the idle loop runs what is
+ * pending before it halts, as with the tick stopped that next
+ * interrupt may be a long way off.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <asm/interrupt.h>
+#include <nodes/softirq.h>
+#include <nodes/sched.h>
+#include <asm/percpu.h>
+
+
+static softirq_handler_t softirq_vec[NUM_OF_SOFTIRQS];
+
+static DEFINE_PER_CPU (u32_t, softirq_pending);  /* One bit per
+						  * pending softirq */
+
+static DEFINE_PER_CPU (u32_t, in_softirq);       /* Set while softirqs
+						  * are running */
+
+
+void open_softirq (u32_t nr, softirq_handler_t handler)
+{
+	softirq_vec[nr] = handler;
+}
+
+
+void raise_softirq (u32_t nr)
+{
+	this_cpu_write (softirq_pending, this_cpu_read (softirq_pending) | (1 << nr));
+}
+
+
+static void do_softirq (void)
+{
+	u32_t pending;
+	u32_t nr;
+
+	this_cpu_write (in_softirq, 1);
+
+	while ( (pending = this_cpu_read (softirq_pending)) != 0){
+		this_cpu_write (softirq_pending, 0);
+		sti();
+
+		for (nr = 0; pending; nr++, pending >>= 1){
+			if ( (pending & 1) && softirq_vec[nr])
+				softirq_vec[nr]();
+		}
+
+		cli();
+	}
+
+	this_cpu_write (in_softirq, 0);
+}
+
+
+int local_softirq_pending (void)
+{
+	return this_cpu_read (softirq_pending) != 0;
+}
+
+
+/* Called with interrupts disabled and returns with them disabled */
+
+void run_softirqs (void)
+{
+	if (this_cpu_read (in_softirq)) return;
+
+	if (this_cpu_read (softirq_pending)) do_softirq();
+}
+
+
+/* Called with interrupts disabled and returns with interrupts
+ * disabled. An interrupt that arrived while softirqs were running
+ * returns straight away. The outermost one runs the softirqs and then
+ * preempts the interrupted task if it has been asked to. */
+
+void irq_exit (void)
+{
+	if (this_cpu_read (in_softirq)) return;
+
+	run_softirqs();
+
+	preempt_schedule_irq();
+}
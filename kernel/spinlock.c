@@ -0,0 +1,102 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/spinlock.c
+ * Description:   Lock statistics.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* The locks themselves are all inline, see nodes/spinlock.h and
+ * asm/spinlock.h. What lives here is the list of locks that keep
+ * statistics. A lock joins it the first time it is taken, while it is
+ * held, so nobody else can be registering the same lock. Different
+ * locks may register at the same time on different processors, so
+ * the list head is swapped in with cmpxchg. Locks never leave the
+ * list.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/spinlock.h>
+#include <asm/atomic.h>
+#include <asm/div64.h>
+#include <io.h>
+
+
+#ifdef CONFIG_LOCK_STAT
+
+static struct lock_stat *volatile lock_stats;
+
+
+void lock_stat_register (struct lock_stat *stat)
+{
+	struct lock_stat *head;
+
+	stat->registered = 1;
+
+	do {
+		head = lock_stats;
+		stat->next = head;
+	} while (cmpxchg ( (volatile u32_t *) &lock_stats, (u32_t) head,
+			   (u32_t) stat) != (u32_t) head);
+}
+
+
+/* The numbers are read without taking the locks, so a line may be a
+ * little inconsistent with itself. */
+
+void lock_stat_print (void)
+{
+	struct lock_stat *stat;
+	u64_t wait, avg_hold, hold;
+
+	printf ("\nLock statistics (cycles)\n");
+	printf ("%-24s %10s %10s %10s %10s %10s\n", "name", "acquired",
+		"contended", "avg wait", "avg hold", "max hold");
+
+	for (stat = lock_stats; stat; stat = stat->next){
+		wait = stat->wait_cycles;
+		if (stat->contended) do_div (&wait, stat->contended);
+
+		avg_hold = stat->hold_cycles;
+		if (stat->acquisitions) do_div (&avg_hold, stat->acquisitions);
+
+		hold = stat->max_hold_cycles;
+		if (hold > 0xffffffff) hold = 0xffffffff;
+		if (wait > 0xffffffff) wait = 0xffffffff;
+		if (avg_hold > 0xffffffff) avg_hold = 0xffffffff;
+
+		printf ("%-24s %10u %10u %10u %10u %10u\n", stat->name,
+			stat->acquisitions, stat->contended, (u32_t) wait,
+			(u32_t) avg_hold, (u32_t) hold);
+	}
+}
+
+#endif /* CONFIG_LOCK_STAT */
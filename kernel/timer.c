@@ -0,0 +1,459 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/timer.c
+ * Description:   A hierarchical timing wheel for kernel timers.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* Timers are kept in five wheels of buckets, indexed by bits of their
+ * expiry time. The first wheel has one bucket for each of the next 256
+ * jiffies. Each of the other four has 64 buckets that each cover 64
+ * times as much time as a bucket of the wheel below it.
+ *
+ * Adding a timer computes its bucket from how far away it expires and
+ * links it in. Deleting a timer unlinks it. Both are O(1) no matter
+ * how many timers there are. On every tick we run the bucket of the
+ * current jiffy. Whenever the first wheel wraps around, the next
+ * bucket of the second wheel is emptied and its timers are spread
+ * over the first wheel (a cascade), and so on up the wheels. Every
+ * timer is cascaded at most four times, so the expiry cost per timer
+ * is amortized O(1).
+ *
+ * Expired timers are run from TIMER_SOFTIRQ, not from the timer
+ * interrupt itself.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/list.h>
+#include <nodes/timer.h>
+#include <nodes/time.h>
+#include <nodes/softirq.h>
+#include <nodes/spinlock.h>
+#include <asm/interrupt.h>
+#include <asm/msr.h>
+#include <asm/div64.h>
+#include <mm/mm.h>
+#include <io.h>
+
+
+#define TVN_BITS 6
+#define TVR_BITS 8
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVR_MASK (TVR_SIZE - 1)
+
+
+struct tvec {
+	struct list_head vec[TVN_SIZE];
+};
+
+struct tvec_root {
+	struct list_head vec[TVR_SIZE];
+};
+
+static struct {
+	spinlock_t lock;        /* Timers are armed from any processor */
+	u32_t timer_jiffies;    /* The next jiffy to run buckets for */
+	struct tvec_root tv1;
+	struct tvec tv2, tv3, tv4, tv5;
+} base;
+
+
+/* Link `timer' into the bucket for its expiry time. The lock of the
+ * wheel is held. */
+
+static void internal_add_timer (struct timer_list *timer)
+{
+	u32_t expires = timer->expires;
+	u32_t idx = expires - base.timer_jiffies;
+	struct list_head *vec;
+	u32_t i;
+
+	if (idx < TVR_SIZE){
+		i = expires & TVR_MASK;
+		vec = base.tv1.vec + i;
+	}
+	else if (idx < 1 << (TVR_BITS + TVN_BITS)){
+		i = (expires >> TVR_BITS) & TVN_MASK;
+		vec = base.tv2.vec + i;
+	}
+	else if (idx < 1 << (TVR_BITS + 2 * TVN_BITS)){
+		i = (expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK;
+		vec = base.tv3.vec + i;
+	}
+	else if (idx < 1 << (TVR_BITS + 3 * TVN_BITS)){
+		i = (expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK;
+		vec = base.tv4.vec + i;
+	}
+	else if ( (s32_t) idx < 0){
+		/* Already expired, run it on the next tick */
+		vec = base.tv1.vec + (base.timer_jiffies & TVR_MASK);
+	}
+	else{
+		/* Clamp to the largest timeout the wheel can hold */
+		if (idx > 0xffffffffUL >> 1){
+			idx = 0xffffffffUL >> 1;
+			expires = idx + base.timer_jiffies;
+		}
+		i = (expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK;
+		vec = base.tv5.vec + i;
+	}
+
+	list_add_tail (&timer->entry, vec);
+}
+
+
+void add_timer (struct timer_list *timer)
+{
+	u32_t flags;
+
+	spin_lock_irqsave (&base.lock, flags);
+	internal_add_timer (timer);
+	spin_unlock_irqrestore (&base.lock, flags);
+}
+
+
+void mod_timer (struct timer_list *timer, u32_t expires)
+{
+	u32_t flags;
+
+	spin_lock_irqsave (&base.lock, flags);
+
+	if (timer_pending (timer)) list_del (&timer->entry);
+
+	timer->expires = expires;
+	internal_add_timer (timer);
+
+	spin_unlock_irqrestore (&base.lock, flags);
+}
+
+
+int del_timer (struct timer_list *timer)
+{
+	u32_t flags;
+	int ret = 0;
+
+	spin_lock_irqsave (&base.lock, flags);
+
+	if (timer_pending (timer)){
+		list_del (&timer->entry);
+		ret = 1;
+	}
+
+	spin_unlock_irqrestore (&base.lock, flags);
+
+	return ret;
+}
+
+
+/* Empty bucket `index' of `tv' and re-add its timers, which puts them
+ * into the wheels below. Returns `index' so the caller knows whether
+ * this wheel wrapped around too. */
+
+static u32_t cascade (struct tvec *tv, u32_t index)
+{
+	struct list_head list, *pos, *n;
+
+	list_replace_init (tv->vec + index, &list);
+
+	list_for_each_safe (pos, n, &list)
+		internal_add_timer (list_entry (pos, struct timer_list, entry));
+
+	return index;
+}
+
+#define INDEX(N) ((base.timer_jiffies >> (TVR_BITS + (N) * TVN_BITS)) & TVN_MASK)
+
+
+/* The TIMER_SOFTIRQ handler. Runs every bucket up to the current
+ * jiffy. The timer functions are called with interrupts enabled and
+ * may add, modify or delete any timer, including their own.
+ */
+
+static void run_timer_softirq (void)
+{
+	struct list_head work;
+	struct timer_list *timer;
+	void (*fn) (void *);
+	void *data;
+	u32_t index;
+
+	spin_lock_irq (&base.lock);
+
+	while (time_after_eq (jiffies, base.timer_jiffies)){
+
+		index = base.timer_jiffies & TVR_MASK;
+
+		if (!index &&
+		    !cascade (&base.tv2, INDEX(0)) &&
+		    !cascade (&base.tv3, INDEX(1)) &&
+		    !cascade (&base.tv4, INDEX(2)))
+			cascade (&base.tv5, INDEX(3));
+
+		base.timer_jiffies++;
+
+		list_replace_init (base.tv1.vec + index, &work);
+
+		while (!list_empty (&work)){
+			timer = list_entry (work.next, struct timer_list, entry);
+			fn = timer->function;
+			data = timer->data;
+
+			list_del (&timer->entry);
+
+			spin_unlock_irq (&base.lock);
+			fn (data);
+			spin_lock_irq (&base.lock);
+		}
+	}
+
+	spin_unlock_irq (&base.lock);
+}
+
+
+/* Finds the first non-empty bucket of the wheel `vec' of `size'
+ * buckets, starting at `index' and wrapping around. Stores the
+ * earliest expiry time in it into `expires' and returns 1, or returns
+ * 0 if the wheel is empty. */
+
+static int first_in_wheel (struct list_head *vec, u32_t size, u32_t index,
+			   u32_t *expires)
+{
+	struct list_head *pos;
+	u32_t i, slot;
+	int found = 0;
+
+	for (i = 0; i < size; i++){
+		slot = (index + i) & (size - 1);
+
+		list_for_each (pos, vec + slot){
+			struct timer_list *t = list_entry (pos, struct timer_list, entry);
+
+			if (!found || time_before (t->expires, *expires))
+				*expires = t->expires;
+			found = 1;
+		}
+
+		if (found) return 1;
+	}
+
+	return 0;
+}
+
+
+/* Returns the jiffy at which the next timer expires, or
+ * NEXT_TIMER_MAX_DELTA ahead if there are none. Buckets within a wheel
+ * are in time order starting from the current one, so the first
+ * non-empty bucket of each wheel holds that wheel's earliest timer. A
+ * timer in an upper wheel can still be due before one in the first
+ * wheel, so every wheel is looked at. Interrupts must be disabled.
+ */
+
+u32_t next_timer_interrupt (void)
+{
+	u32_t next = base.timer_jiffies + NEXT_TIMER_MAX_DELTA;
+	u32_t expires;
+	int n;
+
+	struct tvec *tvs[4] = { &base.tv2, &base.tv3, &base.tv4, &base.tv5 };
+
+	raw_spin_lock (&base.lock);
+
+	/* Expiry is still being processed */
+	if (time_before (base.timer_jiffies, jiffies)){
+		next = jiffies;
+		goto out;
+	}
+
+	if (first_in_wheel (base.tv1.vec, TVR_SIZE, base.timer_jiffies & TVR_MASK,
+			    &expires))
+		next = expires;
+
+	for (n = 0; n < 4; n++){
+		if (first_in_wheel (tvs[n]->vec, TVN_SIZE, INDEX(n) + 1, &expires)
+		    && time_before (expires, next))
+			next = expires;
+	}
+
+ out:
+	raw_spin_unlock (&base.lock);
+	return next;
+}
+
+
+/* Called from the timer tick with interrupts disabled */
+
+void run_local_timers (void)
+{
+	raise_softirq (TIMER_SOFTIRQ);
+}
+
+
+void init_timers (void)
+{
+	int i;
+
+	for (i = 0; i < TVR_SIZE; i++)
+		INIT_LIST_HEAD (base.tv1.vec + i);
+
+	for (i = 0; i < TVN_SIZE; i++){
+		INIT_LIST_HEAD (base.tv2.vec + i);
+		INIT_LIST_HEAD (base.tv3.vec + i);
+		INIT_LIST_HEAD (base.tv4.vec + i);
+		INIT_LIST_HEAD (base.tv5.vec + i);
+	}
+
+	spin_lock_init (&base.lock);
+	base.timer_jiffies = jiffies;
+
+	open_softirq (TIMER_SOFTIRQ, run_timer_softirq);
+}
+
+
+
+/* =============== bench_timers =============== */
+
+#ifdef CONFIG_BENCH
+
+#define BENCH_TIMERS 100000
+
+#define TIMERS_PER_PAGE (PAGE_SIZE_BYTES / sizeof (struct timer_list))
+
+
+static void bench_timer_fn (void *data)
+{
+}
+
+
+/* Returns the average of `cycles' over `n' operations */
+
+static u32_t per_op (u64_t cycles, u32_t n)
+{
+	do_div (&cycles, n);
+	return (u32_t) cycles;
+}
+
+
+/* Insert `timer' into `list' keeping it sorted by expiry. This is
+ * what the wheel replaces. */
+
+static void sorted_list_add (struct list_head *list, struct timer_list *timer)
+{
+	struct list_head *pos;
+
+	list_for_each (pos, list){
+		if (time_after (list_entry (pos, struct timer_list, entry)->expires,
+				timer->expires))
+			break;
+	}
+
+	list_add_tail (&timer->entry, pos);
+}
+
+
+/* The pages the benchmark timers live in. Too big for the stack of
+ * the idle task, which runs the benchmarks. */
+static struct timer_list *
+bench_timer_pages[BENCH_TIMERS / TIMERS_PER_PAGE + 1];
+
+
+/* Arms and cancels BENCH_TIMERS timers in the wheel, then arms
+ * increasing numbers of timers in both the wheel and a sorted list
+ * and prints the cycles per insertion. The timers live in pages from
+ * the lower memory zone.
+ */
+
+void bench_timers (void)
+{
+	struct timer_list *t;
+	struct list_head sorted;
+	u32_t pages = 0, i, n, seed = 12345;
+	u64_t start, arm, cancel;
+
+	for (i = 0; i < BENCH_TIMERS; i += TIMERS_PER_PAGE){
+		bench_timer_pages[pages] =
+			(struct timer_list *) allocate_page (LOW_MEM_ZONE);
+		if (!bench_timer_pages[pages]){
+			printf ("bench_timers: out of memory\n");
+			goto out;
+		}
+		pages++;
+	}
+
+#define TIMER(i)						\
+	(&bench_timer_pages[(i) / TIMERS_PER_PAGE][(i) % TIMERS_PER_PAGE])
+
+	for (i = 0; i < BENCH_TIMERS; i++){
+		t = TIMER(i);
+		init_timer (t);
+		seed = seed * 1103515245 + 12345;
+		t->expires = jiffies + 1000 + (seed >> 8) % 500000;
+		t->function = bench_timer_fn;
+		t->data = 0;
+	}
+
+	printf ("\nTimer wheel, %u timers :\n", BENCH_TIMERS);
+
+	start = rdtsc();
+	for (i = 0; i < BENCH_TIMERS; i++) add_timer (TIMER(i));
+	arm = rdtsc() - start;
+
+	start = rdtsc();
+	for (i = 0; i < BENCH_TIMERS; i++) del_timer (TIMER(i));
+	cancel = rdtsc() - start;
+
+	printf ("  arm : %u cycles/timer  cancel : %u cycles/timer\n",
+		per_op (arm, BENCH_TIMERS), per_op (cancel, BENCH_TIMERS));
+
+	printf ("Arm cost, wheel vs sorted list (cycles/timer) :\n");
+
+	for (n = 100; n <= 10000; n *= 10){
+		start = rdtsc();
+		for (i = 0; i < n; i++) add_timer (TIMER(i));
+		arm = rdtsc() - start;
+		for (i = 0; i < n; i++) del_timer (TIMER(i));
+
+		INIT_LIST_HEAD (&sorted);
+		start = rdtsc();
+		for (i = 0; i < n; i++) sorted_list_add (&sorted, TIMER(i));
+		cancel = rdtsc() - start;
+
+		printf ("  %u timers : wheel %u  list %u\n", n, 
+			per_op (arm, n), per_op (cancel, n));
+	}
+
+ out:
+	while (pages) deallocate_page ( (u32_t) bench_timer_pages[--pages]);
+}
+
+#endif /* CONFIG_BENCH */
@@ -0,0 +1,233 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/trace.c
+ * Description:   Static tracepoints in per processor rings.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* Every processor has a ring of the last TRACE_SLOTS records. Only
+ * the processor itself writes its ring, with interrupts off so a
+ * tracepoint in an interrupt handler can not land in the middle of
+ * one. `head' only ever grows and is published once the record is
+ * filled in, so the dump sees whole records. The dump never writes
+ * `head', it keeps its own count of the records it has put out,
+ * `dumped', so a tracepoint still running on another processor when
+ * the dump starts is not lost or torn by a reset under it.
+ *
+ * A dump goes out on the serial port as text, one line per record
+ * with the bytes of the record in hex, framed by a line in front and
+ * one at the end:
+ *
+ *   @trace begin <version> <processors> <tsc kHz>
+ *   @t <48 hex digits>
+ *   @trace end <records> <overwritten>
+ *
+ * so it survives a terminal and can be picked out of everything else
+ * that was logged. tools/tracedump turns it into a timeline.
+ */
+
+#include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/trace.h>
+#include <nodes/sched.h>
+#include <nodes/wait.h>
+#include <nodes/mutex.h>
+#include <nodes/time.h>
+#include <nodes/devices.h>
+#include <nodes/log.h>
+#include <asm/interrupt.h>
+#include <asm/atomic.h>
+#include <asm/msr.h>
+#include <asm/smp.h>
+#include <io.h>
+
+
+#ifdef CONFIG_TRACE
+
+#define TRACE_VERSION  1
+
+#define TRACE_SLOTS  512   /* Records per processor, a power of two */
+
+#define TRACE_ALIGN  64    /* The size of a cache line */
+
+/* Oldest slots the dump leaves alone in a full ring, as tracepoints
+ * that got past trace_enabled before trace_stop may still write them */
+#define TRACE_SLACK  4
+
+struct trace_ring {
+	volatile u32_t head;   /* Records ever written */
+	u32_t dumped;          /* Records already dumped or skipped.
+				* Only trace_dump touches it. */
+	struct trace_record rec[TRACE_SLOTS] __attribute__ ((aligned (TRACE_ALIGN)));
+} __attribute__ ((aligned (TRACE_ALIGN)));
+
+static struct trace_ring trace_rings[NR_CPUS];
+
+volatile u32_t trace_enabled;
+
+static DEFINE_MUTEX (trace_dump_mutex);
+
+static DECLARE_WAIT_QUEUE_HEAD (trace_dump_wait);
+static volatile u32_t trace_dump_requested;
+
+
+void __trace (u32_t event, u32_t a0, u32_t a1, u32_t a2)
+{
+	struct trace_ring *ring;
+	struct trace_record *rec;
+	u32_t flags, cpu, head;
+
+	local_irq_save (flags);
+
+	cpu = smp_processor_id();
+	ring = &trace_rings[cpu];
+	head = ring->head;
+	rec = &ring->rec[head & (TRACE_SLOTS - 1)];
+
+	rec->stamp = rdtsc();
+	rec->event = event;
+	rec->cpu = cpu;
+	rec->pad = 0;
+	rec->arg[0] = a0;
+	rec->arg[1] = a1;
+	rec->arg[2] = a2;
+
+	store_release (&ring->head, head + 1);
+
+	local_irq_restore (flags);
+}
+
+
+void trace_start (void)
+{
+	trace_enabled = 1;
+}
+
+
+void trace_stop (void)
+{
+	trace_enabled = 0;
+}
+
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/* Put the record `rec' out as a line of `@t' and its bytes in hex */
+
+static void trace_dump_record (const struct trace_record *rec)
+{
+	char line[4 + 2 * sizeof (*rec) + 1];
+	const u8_t *p = (const u8_t *) rec;
+	u32_t i, n = 0;
+
+	line[n++] = '@';
+	line[n++] = 't';
+	line[n++] = ' ';
+
+	for (i = 0; i < sizeof (*rec); i++){
+		line[n++] = hex_digits[p[i] >> 4];
+		line[n++] = hex_digits[p[i] & 0xf];
+	}
+
+	line[n++] = '\n';
+
+	serial_write (line, n);
+}
+
+
+void trace_dump (void)
+{
+	struct trace_ring *ring;
+	u32_t was_enabled, cpu, head, seq, records = 0, overwritten = 0;
+	char line[64];
+	int n;
+
+	mutex_lock (&trace_dump_mutex);
+
+	was_enabled = trace_enabled;
+	trace_stop();
+
+	n = snprintf (line, sizeof (line), "@trace begin %u %u %u\n",
+		      TRACE_VERSION, num_online_cpus, tsc_khz);
+	serial_write (line, n);
+
+	for (cpu = 0; cpu < num_online_cpus; cpu++){
+		ring = &trace_rings[cpu];
+		head = load_acquire (&ring->head);
+
+		seq = ring->dumped;
+		if (head - seq > TRACE_SLOTS - TRACE_SLACK)
+			seq = head - (TRACE_SLOTS - TRACE_SLACK);
+
+		overwritten += seq - ring->dumped;
+		records += head - seq;
+
+		for (; seq != head; seq++)
+			trace_dump_record (&ring->rec[seq & (TRACE_SLOTS - 1)]);
+
+		ring->dumped = head;
+	}
+
+	n = snprintf (line, sizeof (line), "@trace end %u %u\n",
+		      records, overwritten);
+	serial_write (line, n);
+
+	if (was_enabled) trace_start();
+
+	mutex_unlock (&trace_dump_mutex);
+}
+
+
+void trace_request_dump (void)
+{
+	trace_dump_requested = 1;
+	wake_up (&trace_dump_wait);
+}
+
+
+static void tracedump (void *arg)
+{
+	for (;;){
+		wait_event (trace_dump_wait, trace_dump_requested);
+		trace_dump_requested = 0;
+
+		trace_dump();
+		printk (LOG_INFO, "The trace is out on the serial port\n");
+	}
+}
+
+
+void init_trace (void)
+{
+	kthread_create (tracedump, 0, "tracedump");
+}
+
+#endif /* CONFIG_TRACE */
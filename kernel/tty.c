@@ -0,0 +1,170 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/tty.c
+ * Description:   The terminal input queues.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* There is a tty for each virtual console. The keyboard feeds the one
+ * of the console on the display, the serial line feeds tty 0.
+ *
+ * Characters arrive from the keyboard and serial threads in a ring,
+ * and readers sleep on the wait queue of the tty until there is
+ * something in it. The producers take the receive lock to fill the
+ * ring and readers take the read lock to drain it, so there is only
+ * ever one of each.
+ *
+ * Every character carries the time stamp taken by the keyboard
+ * interrupt, and tty_read keeps the time from there to the reader.
+ */
+
+#include <sys/types.h>
+#include <nodes/ring.h>
+#include <nodes/wait.h>
+#include <nodes/spinlock.h>
+#include <nodes/time.h>
+#include <nodes/tty.h>
+#include <asm/msr.h>
+#include <asm/div64.h>
+#include <io.h>
+
+
+#define TTY_BUF_SIZE  256   /* Characters queued for readers, a power
+			     * of two */
+
+struct tty_char {
+	u64_t stamp;
+	u32_t ch;
+};
+
+struct tty {
+	struct ring ring;
+	struct wait_queue_head wait;
+
+	spinlock_t receive_lock;
+	spinlock_t read_lock;
+
+	struct tty_char buf[TTY_BUF_SIZE];
+};
+
+static struct tty ttys[NR_CONSOLES];
+
+/* Keystroke to reader latency, over all the ttys */
+static DEFINE_SPINLOCK (lat_lock);
+static u32_t lat_count;
+static u64_t lat_total, lat_max;
+
+
+void init_tty (void)
+{
+	struct tty *tty;
+
+	for (tty = ttys; tty < ttys + NR_CONSOLES; tty++){
+		ring_init (&tty->ring, tty->buf, TTY_BUF_SIZE,
+			   sizeof (struct tty_char));
+		init_waitqueue_head (&tty->wait);
+		spin_lock_init (&tty->receive_lock);
+		spin_lock_init (&tty->read_lock);
+	}
+}
+
+
+void tty_receive (u32_t n, u32_t ch, u64_t stamp)
+{
+	struct tty *tty = &ttys[n];
+	struct tty_char c;
+	int queued;
+
+	c.stamp = stamp;
+	c.ch = ch;
+
+	spin_lock (&tty->receive_lock);
+	queued = ring_put (&tty->ring, &c);
+	spin_unlock (&tty->receive_lock);
+
+	if (queued) wake_up (&tty->wait);
+}
+
+
+u32_t tty_read (u32_t n, char *buf, u32_t len)
+{
+	struct tty *tty = &ttys[n];
+	struct tty_char c;
+	u64_t lat, total = 0, max = 0;
+	u32_t i;
+
+	for (;;){
+		wait_event (tty->wait, !ring_empty (&tty->ring));
+
+		spin_lock (&tty->read_lock);
+
+		for (i = 0; i < len && ring_get (&tty->ring, &c); i++){
+			buf[i] = c.ch;
+
+			lat = rdtsc() - c.stamp;
+			total += lat;
+			if (lat > max) max = lat;
+		}
+
+		spin_unlock (&tty->read_lock);
+
+		/* Another reader may have emptied it first */
+		if (i) break;
+	}
+
+	spin_lock (&lat_lock);
+	lat_total += total;
+	if (max > lat_max) lat_max = max;
+	lat_count += i;
+	spin_unlock (&lat_lock);
+
+	return i;
+}
+
+
+void tty_latency_print (void)
+{
+	u64_t avg, max;
+	u32_t count;
+
+	spin_lock (&lat_lock);
+	count = lat_count;
+	avg = lat_total;
+	max = lat_max;
+	spin_unlock (&lat_lock);
+
+	if (!count) return;
+
+	do_div (&avg, count);
+
+	printf ("%u keys, keystroke to reader : %u ns on average, %u ns at most\n",
+		count, (u32_t) cycles_to_ns (avg), (u32_t) cycles_to_ns (max));
+}
@@ -0,0 +1,118 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     kernel/wait.c
+ * Description:   Sleeping on and waking up wait queues.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+#include <sys/types.h>
+#include <nodes/list.h>
+#include <nodes/sched.h>
+#include <nodes/spinlock.h>
+#include <nodes/wait.h>
+#include <asm/atomic.h>
+
+
+void init_waitqueue_head (struct wait_queue_head *wq)
+{
+	spin_lock_init (&wq->lock);
+	INIT_LIST_HEAD (&wq->task_list);
+}
+
+
+/* The state is set under the lock, and wake_up takes the same lock,
+ * so the waker either sees us on the list or we see its condition.
+ *
+ * Wakers that look at waitqueue_active without the lock are only
+ * safe because of the mb. Without it the load of the condition after
+ * we return could pass our store to the list, which is still in the
+ * store buffer, and the waker could find the list empty while we see
+ * the old condition and go to sleep. */
+
+void prepare_to_wait (struct wait_queue_head *wq, struct wait_queue *wait)
+{
+	u32_t flags;
+
+	spin_lock_irqsave (&wq->lock, flags);
+
+	if (list_empty (&wait->entry))
+		list_add_tail (&wait->entry, &wq->task_list);
+	current->state = TASK_BLOCKED;
+	mb();
+
+	spin_unlock_irqrestore (&wq->lock, flags);
+}
+
+
+void finish_wait (struct wait_queue_head *wq, struct wait_queue *wait)
+{
+	u32_t flags;
+
+	current->state = TASK_RUNNING;
+
+	spin_lock_irqsave (&wq->lock, flags);
+	list_del_init (&wait->entry);
+	spin_unlock_irqrestore (&wq->lock, flags);
+}
+
+
+/* The sleepers stay on the list until they run finish_wait. Waking a
+ * task that is already running does nothing. */
+
+void wake_up (struct wait_queue_head *wq)
+{
+	struct list_head *pos;
+	u32_t flags;
+
+	spin_lock_irqsave (&wq->lock, flags);
+
+	list_for_each (pos, &wq->task_list)
+		wake_up_task (list_entry (pos, struct wait_queue, entry)->task);
+
+	spin_unlock_irqrestore (&wq->lock, flags);
+}
+
+
+void wake_up_one (struct wait_queue_head *wq)
+{
+	struct wait_queue *wait;
+	u32_t flags;
+
+	spin_lock_irqsave (&wq->lock, flags);
+
+	if (!list_empty (&wq->task_list)){
+		wait = list_entry (wq->task_list.next, struct wait_queue, entry);
+		list_del_init (&wait->entry);
+		wake_up_task (wait->task);
+	}
+
+	spin_unlock_irqrestore (&wq->lock, flags);
+}
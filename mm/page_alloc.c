@@ -57,6 +57,15 @@
 #include <mm/mm.h>
 
 #include <sys/types.h>
+#include <nodes/config.h>
+#include <nodes/spinlock.h>
+#include <nodes/time.h>
+#include <asm/percpu.h>
+#include <asm/atomic.h>
+#include <asm/div64.h>
+#include <asm/smp.h>
+#include <nodes/log.h>
+#include <nodes/trace.h>
 
 #include <io.h>  /* Included mainly for debug purposes */
 
@@ -75,6 +84,12 @@ static u32_t *end_of_low_mem;  /* This is a pointer to one past the
 static u32_t *end_of_high_mem;  /* This is a pointer to one past the
 				 * end of the higher memory stack */
 
+static DEFINE_SPINLOCK (page_alloc_lock);  /* Protects both stacks.
+					    * Pages are freed from
+					    * interrupt context, so
+					    * it is always taken with
+					    * interrupts off. */
+
 
 
 
@@ -133,6 +148,142 @@ void init_page_alloc (u32_t upper_mem_kb, u32_t img_phys_end_addr)
 }
 
 
+/* ================== page magazines ================== */
+
+/* With more than one processor the two stacks are a single point that
+ * every allocation fights over. So each processor keeps a magazine of
+ * free pages for each zone, a small stack of its own in front of the
+ * shared one. Allocating pops from the magazine and freeing pushes
+ * onto it, with interrupts disabled but without the lock and without
+ * touching memory that another processor writes. Only when a magazine
+ * runs empty is it refilled with PAGE_MAG_BATCH pages from the zone
+ * stack, and only when it is full are the PAGE_MAG_BATCH pages at its
+ * bottom, the ones freed longest ago, pushed back.
+ *
+ * A page freed on one processor may be reused on another, it simply
+ * goes through the shared stack on the way. The pages sitting in the
+ * magazines of other processors are not seen by an allocation that
+ * finds its own magazine and the stack empty.
+ */
+
+#define PAGE_MAG_SIZE   64   /* Pages a magazine holds */
+#define PAGE_MAG_BATCH  32   /* Pages moved to or from the stack
+			      * at once */
+
+struct page_magazine {
+	u32_t count;                  /* Pages in `pages' */
+	u32_t pages[PAGE_MAG_SIZE];   /* The top is pages[count - 1] */
+};
+
+/* One magazine for each zone, indexed by LOW_MEM_ZONE and
+ * HIGH_MEM_ZONE */
+static DEFINE_PER_CPU (struct page_magazine [2], page_mags);
+
+/* Off until the per processor variables can be reached. Until then
+ * the template of the per processor area would be used, and every
+ * processor would get a copy of its pages. */
+static int page_mags_enabled;
+
+
+void enable_page_magazines (void)
+{
+	page_mags_enabled = 1;
+}
+
+
+static inline struct page_magazine *this_page_mag (u32_t zone)
+{
+	return &(*this_cpu_ptr (page_mags))[zone];
+}
+
+
+/* Pop a page off the stack of `zone', with no fallback to the other
+ * zone. Returns 0 if it is empty. page_alloc_lock is held. */
+
+static inline u32_t __pop_page (u32_t zone)
+{
+	if (zone == HIGH_MEM_ZONE){
+		if (high_mem < end_of_high_mem) return *high_mem++;
+	}
+	else if (low_mem < end_of_low_mem) return *low_mem++;
+
+	return 0;
+}
+
+
+/* Push `page_addr' onto the stack of its zone. page_alloc_lock is
+ * held. */
+
+static inline void __push_page (u32_t page_addr)
+{
+	if ( page_addr < LOW_MEM_BOUNDARY) *--low_mem = page_addr;
+	else *--high_mem = page_addr;
+}
+
+
+/* Fill the empty magazine `mag' of `zone' with up to PAGE_MAG_BATCH
+ * pages. Returns the number it got. Like page_mag_drain, it is called
+ * with interrupts disabled. */
+
+static u32_t page_mag_refill (struct page_magazine *mag, u32_t zone)
+{
+	u32_t page;
+
+	raw_spin_lock (&page_alloc_lock);
+
+	while (mag->count < PAGE_MAG_BATCH && (page = __pop_page (zone)))
+		mag->pages[mag->count++] = page;
+
+	raw_spin_unlock (&page_alloc_lock);
+
+	return mag->count;
+}
+
+
+/* Give the bottom `n' pages of the magazine `mag' back to the stack
+ * and slide the rest down. The page freed last ends up on top of the
+ * stack. */
+
+static void page_mag_drain (struct page_magazine *mag, u32_t n)
+{
+	u32_t i;
+
+	raw_spin_lock (&page_alloc_lock);
+
+	for (i = 0; i < n; i++)
+		__push_page (mag->pages[i]);
+
+	raw_spin_unlock (&page_alloc_lock);
+
+	for (i = n; i < mag->count; i++)
+		mag->pages[i - n] = mag->pages[i];
+
+	mag->count -= n;
+}
+
+
+/* Empty both magazines of this processor into the stacks */
+
+static void page_mags_flush (void)
+{
+	struct page_magazine *mag;
+	u32_t flags;
+
+	if (!page_mags_enabled) return;
+
+	local_irq_save (flags);
+
+	mag = this_page_mag (LOW_MEM_ZONE);
+	page_mag_drain (mag, mag->count);
+
+	mag = this_page_mag (HIGH_MEM_ZONE);
+	page_mag_drain (mag, mag->count);
+
+	local_irq_restore (flags);
+}
+
+
+
 /* ================== allocate_page ================== */
 
 /* The strategy here is simple. If the request is an allocation to the
@@ -146,24 +297,66 @@ void init_page_alloc (u32_t upper_mem_kb, u32_t img_phys_end_addr)
  * not invoke the pager.
  *
  * You must be wondering, how do we allocate pages? Well all we do is
- * pop of the address the top of the relevant stack. Thats it!
+ * pop of the address the top of the relevant stack. Thats it! Once
+ * the magazines are enabled, the stack we pop from is the magazine of
+ * this processor.
  */
 
+/* Pop a page straight off the locked stacks, as allocate_page does
+ * before the magazines are enabled */
+
+static u32_t stack_alloc_page (u32_t zone)
+{
+	u32_t page = 0;
+	u32_t flags;
+
+	spin_lock_irqsave (&page_alloc_lock, flags);
+
+	if (zone == HIGH_MEM_ZONE) page = __pop_page (HIGH_MEM_ZONE);
+	if (!page) page = __pop_page (LOW_MEM_ZONE);
+
+	spin_unlock_irqrestore (&page_alloc_lock, flags);
+
+	return page;
+}
+
+
 u32_t allocate_page (u32_t zone)
 {
+	struct page_magazine *mag;
 	u32_t page = 0;
+	u32_t flags;
 
-	if ( zone == HIGH_MEM_ZONE && high_mem < end_of_high_mem){
-		page = *high_mem;
-		high_mem++;
+	if (!page_mags_enabled){
+		page = stack_alloc_page (zone);
+		goto out;
 	}
-	else if (low_mem < end_of_low_mem){
-		page = *low_mem;
-		low_mem++;
+
+	/* Interrupts off keep us on this processor and out of the
+	 * way of a free from an interrupt handler */
+	local_irq_save (flags);
+
+	if (zone == HIGH_MEM_ZONE){
+		mag = this_page_mag (HIGH_MEM_ZONE);
+		if (mag->count || page_mag_refill (mag, HIGH_MEM_ZONE))
+			page = mag->pages[--mag->count];
+	}
+
+	if (!page){
+		mag = this_page_mag (LOW_MEM_ZONE);
+		if (mag->count || page_mag_refill (mag, LOW_MEM_ZONE))
+			page = mag->pages[--mag->count];
 	}
-	else if ( zone == LOW_MEM_ZONE) printf ("\n\nNo more pages in lower memory\n\n");
-	else printf ("\n\nOut of physical memory..\n\n");
 
+	local_irq_restore (flags);
+
+ out:
+	trace (TRACE_PAGE_ALLOC, zone, page, 0);
+
+	if (!page){
+		if ( zone == LOW_MEM_ZONE) printk (LOG_ERR, "No more pages in lower memory\n");
+		else printk (LOG_ERR, "Out of physical memory..\n");
+	}
 	
 	return page;
 }
@@ -176,16 +369,37 @@ u32_t allocate_page (u32_t zone)
  * then push the passed address onto that stack. As simple as A B C
  */
 
+static void stack_free_page (u32_t page_addr)
+{
+	u32_t flags;
+
+	spin_lock_irqsave (&page_alloc_lock, flags);
+	__push_page (page_addr);
+	spin_unlock_irqrestore (&page_alloc_lock, flags);
+}
+
+
 void deallocate_page (u32_t page_addr)
 {
-	if ( page_addr < LOW_MEM_BOUNDARY){
-		low_mem--;
-		*low_mem = page_addr;
-	}
-	else{
-		high_mem--;
-		*high_mem = page_addr;
+	struct page_magazine *mag;
+	u32_t flags;
+
+	trace (TRACE_PAGE_FREE, page_addr, 0, 0);
+
+	if (!page_mags_enabled){
+		stack_free_page (page_addr);
+		return;
 	}
+
+	local_irq_save (flags);
+
+	mag = this_page_mag (page_addr < LOW_MEM_BOUNDARY ? LOW_MEM_ZONE
+			     : HIGH_MEM_ZONE);
+
+	if (mag->count == PAGE_MAG_SIZE) page_mag_drain (mag, PAGE_MAG_BATCH);
+	mag->pages[mag->count++] = page_addr;
+
+	local_irq_restore (flags);
 }
 
 
@@ -218,6 +432,9 @@ void test_page_alloc (void)
 	printf ("\nDeallocating 15 pages from upper memory : \n");
 	for (i = 0; i < 15; i++) deallocate_page (addresses[i]);
 
+	/* The pages we freed are in our magazine, not on the stack */
+	page_mags_flush();
+
 	printf ("The first 15 pages in upper memory are : \n");
 	for (i = 0; i < 15; i++) printf("0x%x\t", high_mem[i]);
 
@@ -225,3 +442,139 @@ void test_page_alloc (void)
 	
 
 }
+
+
+
+/* =============== bench_page_alloc =============== */
+
+#ifdef CONFIG_BENCH
+
+#define BENCH_PAGE_ROUNDS  20000
+#define BENCH_PAGE_BURST   8      /* Pages each worker holds at once */
+
+static volatile u32_t bench_ready, bench_done, bench_nr;
+
+/* Set for a run straight on the locked stacks. The allocator itself
+ * is left alone, the rest of the kernel keeps using the magazines. */
+static u32_t bench_shared;
+static u64_t bench_cycles[NR_CPUS];
+
+
+/* Waits until all the workers are running, then allocates and frees
+ * BENCH_PAGE_BURST pages BENCH_PAGE_ROUNDS times */
+
+static void page_worker (void *arg)
+{
+	u32_t cpu = (u32_t) arg;
+	u32_t pages[BENCH_PAGE_BURST];
+	u32_t r, i;
+	u64_t start;
+
+	xadd (&bench_ready, 1);
+	while (bench_ready < bench_nr) cpu_relax();
+
+	start = rdtsc();
+
+	for (r = 0; r < BENCH_PAGE_ROUNDS; r++){
+		for (i = 0; i < BENCH_PAGE_BURST; i++)
+			pages[i] = bench_shared ?
+				stack_alloc_page (HIGH_MEM_ZONE) :
+				allocate_page (HIGH_MEM_ZONE);
+
+		for (i = 0; i < BENCH_PAGE_BURST; i++){
+			if (!pages[i]) continue;
+			if (bench_shared) stack_free_page (pages[i]);
+			else deallocate_page (pages[i]);
+		}
+	}
+
+	bench_cycles[cpu] = rdtsc() - start;
+
+	xadd (&bench_done, 1);
+}
+
+
+/* Run a worker on each of processors 0 to `n' - 1 and return the
+ * cycles the slowest one took. We are the idle task of processor 0,
+ * so its worker runs once we call schedule and we get the processor
+ * back when it has exited. */
+
+static u64_t bench_page_run (u32_t n)
+{
+	u64_t slowest = 0;
+	u32_t cpu, started = 0;
+
+	bench_ready = bench_done = 0;
+	bench_nr = n;
+
+	for (cpu = 0; cpu < n; cpu++){
+		bench_cycles[cpu] = 0;
+		if (kthread_create_on_cpu (page_worker, (void *) cpu, "page_worker", cpu))
+			started++;
+	}
+
+	/* Let the workers that did start go on without the others */
+	bench_nr = started;
+
+	schedule();
+
+	while (bench_done < started) cpu_relax();
+
+	for (cpu = 0; cpu < n; cpu++)
+		if (bench_cycles[cpu] > slowest) slowest = bench_cycles[cpu];
+
+	return slowest;
+}
+
+
+/* Pages allocated and freed per millisecond by `n' processors which
+ * took `cycles' */
+
+static u32_t pages_per_ms (u32_t n, u64_t cycles)
+{
+	u64_t ns = cycles_to_ns (cycles), pages;
+
+	do_div (&ns, 1000);
+	if (!ns) return 0;
+
+	pages = (u64_t) n * BENCH_PAGE_ROUNDS * BENCH_PAGE_BURST * 1000;
+	do_div (&pages, (u32_t) ns);
+
+	return (u32_t) pages;
+}
+
+
+/* For 1 to all the processors, time the workers once straight on the
+ * locked stacks and once through the magazines. Reports the cycles
+ * per allocation and free on each processor and the pages allocated
+ * and freed per millisecond by all of them together. */
+
+void bench_page_alloc (void)
+{
+	u64_t shared, mags, per;
+	u32_t n, shared_op, mags_op;
+
+	printf ("\nPage alloc and free, %u pages at a time :\n", BENCH_PAGE_BURST);
+
+	for (n = 1; n <= num_online_cpus; n++){
+		bench_shared = 1;
+		shared = bench_page_run (n);
+
+		bench_shared = 0;
+		mags = bench_page_run (n);
+
+		per = shared;
+		do_div (&per, BENCH_PAGE_ROUNDS * BENCH_PAGE_BURST);
+		shared_op = (u32_t) per;
+
+		per = mags;
+		do_div (&per, BENCH_PAGE_ROUNDS * BENCH_PAGE_BURST);
+		mags_op = (u32_t) per;
+
+		printf ("  %u cpus : stacks %u cycles %u pages/ms, magazines %u cycles %u pages/ms\n",
+			n, shared_op, pages_per_ms (n, shared), mags_op,
+			pages_per_ms (n, mags));
+	}
+}
+
+#endif /* CONFIG_BENCH */
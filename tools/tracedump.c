@@ -0,0 +1,256 @@
+/*********************************************************************
+ *                
+ * Copyright (C) 2004,  Apurva Mehta
+ *                
+ * File path:     tools/tracedump.c
+ * Description:   Turns a trace dump from the serial port into a
+ *                timeline for a trace viewer.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *                
+ ********************************************************************/
+
+/* This runs on the host, not in the kernel. Build it with
+ *
+ *   make tools/tracedump
+ *
+ * and feed it what came out of the serial port:
+ *
+ *   tools/tracedump < serial.log > trace.json
+ *
+ * The output is in the JSON trace event format, which chrome://tracing
+ * and Perfetto load. Every processor is a thread, irqs are slices from
+ * entry to exit and the other events are instants. When the log holds
+ * more than one dump the last whole one is used.
+ *
+ * The record layout and the events must match include/nodes/trace.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define TRACE_VERSION  1
+
+#define TRACE_IRQ_ENTRY    1
+#define TRACE_IRQ_EXIT     2
+#define TRACE_PAGE_ALLOC   3
+#define TRACE_PAGE_FREE    4
+#define TRACE_KB_SCAN      5
+
+#define RECORD_SIZE  24   /* Bytes of a struct trace_record */
+
+struct record {
+	unsigned long long stamp;
+	unsigned int event;
+	unsigned int cpu;
+	unsigned int arg[3];
+};
+
+static struct record *records;
+static unsigned int nr_records, max_records;
+
+static unsigned int khz;
+
+
+static unsigned int le32 (const unsigned char *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int) p[3] << 24;
+}
+
+
+static int hex (int c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+
+/* Decode the hex after "@t " into a record. Returns 0 if the line is
+ * damaged. */
+
+static int parse_record (const char *s, struct record *r)
+{
+	unsigned char b[RECORD_SIZE];
+	int i, hi, lo;
+
+	for (i = 0; i < RECORD_SIZE; i++){
+		hi = hex (s[2 * i]);
+		lo = hi < 0 ? -1 : hex (s[2 * i + 1]);
+		if (lo < 0) return 0;
+		b[i] = hi << 4 | lo;
+	}
+
+	r->stamp = le32 (b) | (unsigned long long) le32 (b + 4) << 32;
+	r->event = b[8] | b[9] << 8;
+	r->cpu = b[10];
+	r->arg[0] = le32 (b + 12);
+	r->arg[1] = le32 (b + 16);
+	r->arg[2] = le32 (b + 20);
+
+	return 1;
+}
+
+
+static void add_record (const struct record *r)
+{
+	if (nr_records == max_records){
+		max_records = max_records ? 2 * max_records : 1024;
+		records = realloc (records, max_records * sizeof (*records));
+		if (!records){
+			perror ("tracedump");
+			exit (1);
+		}
+	}
+
+	records[nr_records++] = *r;
+}
+
+
+static int by_stamp (const void *a, const void *b)
+{
+	const struct record *x = a, *y = b;
+
+	if (x->stamp != y->stamp) return x->stamp < y->stamp ? -1 : 1;
+	return 0;
+}
+
+
+/* Microseconds from `base' to `stamp', or cycles if the frequency of
+ * the time stamp counter is not known */
+
+static double usecs (unsigned long long stamp, unsigned long long base)
+{
+	if (!khz) return (double) (stamp - base);
+
+	return (double) (stamp - base) * 1000.0 / khz;
+}
+
+
+static void print_event (const struct record *r, unsigned long long base,
+			 int first)
+{
+	printf ("%s\n  {\"pid\": 0, \"tid\": %u, \"ts\": %.3f, ",
+		first ? "" : ",", r->cpu, usecs (r->stamp, base));
+
+	switch (r->event){
+	case TRACE_IRQ_ENTRY:
+		printf ("\"ph\": \"B\", \"name\": \"irq %u\"}", r->arg[0]);
+		break;
+	case TRACE_IRQ_EXIT:
+		printf ("\"ph\": \"E\", \"name\": \"irq %u\", "
+			"\"args\": {\"ret\": %u}}", r->arg[0], r->arg[1]);
+		break;
+	case TRACE_PAGE_ALLOC:
+		printf ("\"ph\": \"i\", \"s\": \"t\", \"name\": \"page_alloc\", "
+			"\"args\": {\"zone\": %u, \"page\": \"0x%x\"}}",
+			r->arg[0], r->arg[1]);
+		break;
+	case TRACE_PAGE_FREE:
+		printf ("\"ph\": \"i\", \"s\": \"t\", \"name\": \"page_free\", "
+			"\"args\": {\"page\": \"0x%x\"}}", r->arg[0]);
+		break;
+	case TRACE_KB_SCAN:
+		printf ("\"ph\": \"i\", \"s\": \"t\", \"name\": \"kb_scan\", "
+			"\"args\": {\"code\": \"0x%02x\"}}", r->arg[0]);
+		break;
+	default:
+		printf ("\"ph\": \"i\", \"s\": \"t\", \"name\": \"event %u\", "
+			"\"args\": {\"arg0\": %u, \"arg1\": %u, \"arg2\": %u}}",
+			r->event, r->arg[0], r->arg[1], r->arg[2]);
+	}
+}
+
+
+int main (void)
+{
+	char line[512], *p;
+	struct record r;
+	unsigned int version, cpus, dump_khz, count = 0, lost = 0;
+	unsigned int i, keep = 0, damaged = 0, in_dump = 0;
+
+	/* Lines may have other output in front of them, so look for
+	 * the markers anywhere in a line */
+	while (fgets (line, sizeof (line), stdin)){
+		if ( (p = strstr (line, "@trace begin "))){
+			if (sscanf (p, "@trace begin %u %u %u",
+				    &version, &cpus, &dump_khz) != 3 ||
+			    version != TRACE_VERSION){
+				fprintf (stderr, "tracedump: unknown dump format\n");
+				continue;
+			}
+
+			/* Drop a dump that never ended */
+			nr_records = keep;
+			khz = dump_khz;
+			in_dump = 1;
+		}
+		else if ( (p = strstr (line, "@trace end ")) && in_dump){
+			sscanf (p, "@trace end %u %u", &count, &lost);
+
+			/* A later dump replaces this one */
+			for (i = keep; i < nr_records; i++)
+				records[i - keep] = records[i];
+			nr_records -= keep;
+			keep = nr_records;
+			in_dump = 0;
+		}
+		else if ( (p = strstr (line, "@t ")) && in_dump){
+			if (parse_record (p + 3, &r)) add_record (&r);
+			else damaged++;
+		}
+	}
+
+	nr_records = keep;
+
+	if (!nr_records){
+		fprintf (stderr, "tracedump: no trace found\n");
+		return 1;
+	}
+
+	qsort (records, nr_records, sizeof (*records), by_stamp);
+
+	printf ("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+
+	for (i = 0; i < nr_records; i++)
+		print_event (&records[i], records[0].stamp, !i);
+
+	printf ("\n]}\n");
+
+	fprintf (stderr, "tracedump: %u records, %u overwritten in the kernel, "
+		 "%u damaged\n", nr_records, lost, damaged);
+
+	if (nr_records != count)
+		fprintf (stderr, "tracedump: the kernel sent %u records\n", count);
+
+	if (!khz) fprintf (stderr, "tracedump: the TSC rate is not known, "
+			   "times are in cycles\n");
+
+	return 0;
+}